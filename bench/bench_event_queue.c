@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../simulation/min_heap.h"
+#include "../simulation/event_queue.h"
+
+// Hold model: fill the queue with n entries, then repeatedly pop the
+// earliest and push it back a random delay later, which is the pattern
+// sync_simulation produces.
+
+#define BENCH_SEED 123456
+#define HOLD_OPERATIONS 1000000
+
+static double elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static double bench_mheap(int n) {
+    struct timespec start, end;
+    mheap *h = make_mheap();
+    void *data;
+    int clock;
+
+    srand(BENCH_SEED);
+    for (int i = 0; i < n; i++) mheap_push(h, NULL, rand() % 1000);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < HOLD_OPERATIONS; i++) {
+        mheap_pop(h, &data, &clock);
+        mheap_push(h, data, clock + 1000 + rand() % 1000);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    destroy_mheap(h);
+    return elapsed_ns(&start, &end) / HOLD_OPERATIONS;
+}
+
+static double bench_event_queue(int n) {
+    struct timespec start, end;
+    event_queue *q = make_event_queue();
+    struct event *events = malloc(n * sizeof(struct event));
+    struct event *data;
+    sim_clock clock;
+
+    srand(BENCH_SEED);
+    for (int i = 0; i < n; i++) event_queue_push(q, &events[i], rand() % 1000);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < HOLD_OPERATIONS; i++) {
+        event_queue_pop(q, &data, &clock);
+        event_queue_push(q, data, clock + 1000 + rand() % 1000);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    destroy_event_queue(q);
+    free((void*)events);
+    return elapsed_ns(&start, &end) / HOLD_OPERATIONS;
+}
+
+int main(void) {
+    printf("queue,agents,ns_per_hold\n");
+    for (int n = 1000; n <= 1000000; n *= 10) {
+        printf("mheap,%d,%.1f\n", n, bench_mheap(n));
+        printf("event_queue,%d,%.1f\n", n, bench_event_queue(n));
+    }
+    return 0;
+}
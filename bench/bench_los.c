@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../helpers.h"
+#include "../level/level.h"
+#include "../los/los.h"
+#include "../los/fov.h"
+#include "../path/room_graph.h"
+
+// Times line of sight and field of view on maps from make_level(), over a
+// range of seeds given on the command line. Each row carries a checksum of
+// every answer, so a faster algorithm can be checked for giving the same
+// ones. Curses is never started, the level only needs its tile values.
+//
+// make_level() shuts every door, so each map is run once as generated and
+// once with its doors opened, where sight runs between rooms. Seeds that
+// lay out a single room have no doors to open and are skipped.
+
+#define BENCH_SEED 123456
+#define BENCH_FIRST_MAP 1
+#define BENCH_LAST_MAP 20
+// Few enough lines for the warm pass to find most of them still cached
+#define BENCH_PAIRS (LOS_CACHE_SIZE / 2)
+#define BENCH_FOV_ORIGINS 50
+#define BENCH_MOB_TURNS 50
+
+struct result {
+    long calls;
+    double ns;
+    unsigned long checksum;
+    // Sight cache lookups, for the rows that go through it
+    long hits;
+    long misses;
+};
+
+static const int densities[] = { 10, 100, 1000 };
+#define DENSITY_COUNT (int)(sizeof(densities) / sizeof(densities[0]))
+
+// Every row, for one way of leaving the doors
+struct results {
+    struct result cold, warm, walk, shadowcast, symmetric;
+    struct result by_fov[DENSITY_COUNT], by_line[DENSITY_COUNT];
+};
+
+static double elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static void add_answer(struct result *r, bool answer) {
+    r->checksum = r->checksum * 31 + answer;
+}
+
+static void print_result(const char *name, const char *doors, int density, struct result *r) {
+    printf("%s,%s,%d,%ld,%.1f,%ld,%ld,%016lx\n", name, doors, density, r->calls, r->ns / r->calls,
+            r->hits, r->misses, r->checksum);
+}
+
+static void random_floor(level *lvl, int *x, int *y) {
+    do {
+        *x = rand_int(lvl->width - 1);
+        *y = rand_int(lvl->height - 1);
+    } while (lvl->tiles[*x][*y] == TILE_WALL || lvl->tiles[*x][*y] == DOOR_CLOSED);
+}
+
+// Lines between random pairs of floor tiles, first against an empty cache,
+// then again against the cache the first pass left, then walked without it
+static void bench_lines(level *lvl, struct result *cold, struct result *warm, struct result *walk) {
+    static int pairs[BENCH_PAIRS][4];
+    struct timespec start, end;
+    for (int i = 0; i < BENCH_PAIRS; i++) {
+        random_floor(lvl, &pairs[i][0], &pairs[i][1]);
+        random_floor(lvl, &pairs[i][2], &pairs[i][3]);
+    }
+
+    struct result *passes[2] = { cold, warm };
+    for (int pass = 0; pass < 2; pass++) {
+        bool seen[BENCH_PAIRS];
+        long hits = lvl->sight_cache->hits;
+        long misses = lvl->sight_cache->misses;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < BENCH_PAIRS; i++) {
+            seen[i] = line_of_sight(lvl, pairs[i][0], pairs[i][1], pairs[i][2], pairs[i][3]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        passes[pass]->ns += elapsed_ns(&start, &end);
+        passes[pass]->calls += BENCH_PAIRS;
+        passes[pass]->hits += lvl->sight_cache->hits - hits;
+        passes[pass]->misses += lvl->sight_cache->misses - misses;
+        for (int i = 0; i < BENCH_PAIRS; i++) add_answer(passes[pass], seen[i]);
+    }
+
+    bool seen[BENCH_PAIRS];
+    int bx, by;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_PAIRS; i++) {
+        seen[i] = !line_first_blocker(lvl, pairs[i][0], pairs[i][1], pairs[i][2], pairs[i][3], &bx, &by);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    walk->ns += elapsed_ns(&start, &end);
+    walk->calls += BENCH_PAIRS;
+    for (int i = 0; i < BENCH_PAIRS; i++) add_answer(walk, seen[i]);
+}
+
+// The player's field of view as draw_level() shows it, from random spots
+static void bench_fov(level *lvl, enum fov_mode mode, struct result *r) {
+    struct timespec start, end;
+    for (int i = 0; i < BENCH_FOV_ORIGINS; i++) {
+        int x, y;
+        random_floor(lvl, &x, &y);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        compute_fov(lvl, x, y, PLAYER_SIGHT_RADIUS, mode, lvl->visible);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        r->ns += elapsed_ns(&start, &end);
+        r->calls++;
+        for (int xx = 0; xx < lvl->width; xx++) {
+            for (int yy = 0; yy < lvl->height; yy++) add_answer(r, lvl->visible[xx][yy]);
+        }
+    }
+}
+
+// Whether each of count mobs sees the player, over a few turns of both
+// moving about: once off the player's field of view as level_update_vision()
+// does, FOV included, and once with a line from every mob in sight range
+static void bench_mobs(level *lvl, int count, struct result *by_fov, struct result *by_line) {
+    struct timespec start, end;
+    mobile *mobs = malloc(count * sizeof(mobile));
+    bool *seen = malloc(count * sizeof(bool));
+    if (mobs == NULL || seen == NULL) exit(1);
+    mobile *player = lvl->player;
+    int player_x = player->x;
+    int player_y = player->y;
+
+    for (int turn = 0; turn < BENCH_MOB_TURNS; turn++) {
+        random_floor(lvl, &player->x, &player->y);
+        for (int i = 0; i < count; i++) random_floor(lvl, &mobs[i].x, &mobs[i].y);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        compute_fov(lvl, player->x, player->y, PLAYER_SIGHT_RADIUS, FOV_SYMMETRIC, lvl->visible);
+        for (int i = 0; i < count; i++) seen[i] = mob_sees_player(lvl, &mobs[i]);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        by_fov->ns += elapsed_ns(&start, &end);
+        by_fov->calls += count;
+        for (int i = 0; i < count; i++) add_answer(by_fov, seen[i]);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < count; i++) {
+            int dx = mobs[i].x - player->x;
+            int dy = mobs[i].y - player->y;
+            seen[i] = dx*dx + dy*dy <= MOB_SIGHT_RADIUS*MOB_SIGHT_RADIUS && can_see(lvl, &mobs[i], player->x, player->y);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        by_line->ns += elapsed_ns(&start, &end);
+        by_line->calls += count;
+        for (int i = 0; i < count; i++) add_answer(by_line, seen[i]);
+    }
+
+    player->x = player_x;
+    player->y = player_y;
+    free((void*)mobs);
+    free((void*)seen);
+}
+
+static void open_doors(level *lvl) {
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            if (lvl->tiles[x][y] != DOOR_CLOSED) continue;
+            lvl->tiles[x][y] = DOOR_OPEN;
+            level_terrain_changed(lvl, x, y);
+        }
+    }
+}
+
+static void bench_map(level *lvl, int map, struct results *r) {
+    srand(BENCH_SEED + map);
+    bench_lines(lvl, &r->cold, &r->warm, &r->walk);
+    bench_fov(lvl, FOV_SHADOWCAST, &r->shadowcast);
+    bench_fov(lvl, FOV_SYMMETRIC, &r->symmetric);
+    for (int d = 0; d < DENSITY_COUNT; d++) bench_mobs(lvl, densities[d], &r->by_fov[d], &r->by_line[d]);
+}
+
+static void print_results(const char *doors, struct results *r) {
+    print_result("los_cold", doors, 0, &r->cold);
+    print_result("los_warm", doors, 0, &r->warm);
+    print_result("line_walk", doors, 0, &r->walk);
+    print_result("fov_shadowcast", doors, 0, &r->shadowcast);
+    print_result("fov_symmetric", doors, 0, &r->symmetric);
+    for (int d = 0; d < DENSITY_COUNT; d++) {
+        print_result("mob_sees_player", doors, densities[d], &r->by_fov[d]);
+        print_result("mob_line_to_player", doors, densities[d], &r->by_line[d]);
+    }
+}
+
+int main(int argc, char **argv) {
+    int first = argc > 1 ? atoi(argv[1]) : BENCH_FIRST_MAP;
+    int last = argc > 2 ? atoi(argv[2]) : BENCH_LAST_MAP;
+
+    // make_level() names the player after the user
+    setenv("USER", "bench", 0);
+
+    struct results closed = {0}, open = {0};
+    int maps = 0;
+    for (int map = first; map <= last; map++) {
+        level *lvl = make_level(map);
+        if (lvl->rooms->room_count == 1) {
+            fprintf(stderr, "map %d is a single room, skipped\n", map);
+            destroy_level(lvl);
+            continue;
+        }
+        bench_map(lvl, map, &closed);
+        open_doors(lvl);
+        bench_map(lvl, map, &open);
+        destroy_level(lvl);
+        maps++;
+    }
+    if (maps == 0) {
+        fprintf(stderr, "no maps with more than one room between %d and %d\n", first, last);
+        return 1;
+    }
+
+    printf("bench,doors,mobs,calls,ns_per_call,cache_hits,cache_misses,checksum\n");
+    print_results("closed", &closed);
+    print_results("open", &open);
+    return 0;
+}
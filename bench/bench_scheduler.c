@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "../helpers.h"
+#include "../simulation/simulation.h"
+
+// Runs whole simulations with the firing distributions the game uses:
+// every turn, or a turn plus an exponential tail like random_walk_next_firing
+
+#define BENCH_SEED 123456
+#define TICKS_PER_TURN 1000
+#define BENCH_TURNS 20
+
+static int random_walk_like_firing(void *context, void* st, struct event_listener *listeners) {
+    float rate = 0.5;
+    float r = frand();
+    int next_fire = log(1-r)/(-rate) * TICKS_PER_TURN;
+    if (next_fire < TICKS_PER_TURN) return TICKS_PER_TURN;
+    return next_fire;
+}
+
+static int every_turn_like_firing(void *context, void* st, struct event_listener *listeners) {
+    return TICKS_PER_TURN;
+}
+
+static void count_fire(void *context, void* st) {
+    (*(long*)context)++;
+}
+
+static double elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static double bench(enum queue_type type, int n) {
+    struct timespec start, end;
+    long fired = 0;
+    struct simulation *sim = make_simulation_with_queue(&fired, type, TICKS_PER_TURN);
+    struct event_listener *listeners = malloc(n*SENSORY_EVENT_COUNT*sizeof(struct event_listener));
+
+    srand(BENCH_SEED);
+    for (int i = 0; i < n; i++) {
+        struct agent a;
+        a.state = NULL;
+        a.next_firing = (i % 10 == 0) ? every_turn_like_firing : random_walk_like_firing;
+        a.fire = count_fire;
+        a.kind = 0;
+        a.plan = NULL;
+        a.apply = NULL;
+        a.listeners = &listeners[i*SENSORY_EVENT_COUNT];
+        schedule_event(sim, simulation_push_agent(sim, &a), 0);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int turn = 1; turn <= BENCH_TURNS; turn++) {
+        sync_simulation(sim, (sim_clock)turn * TICKS_PER_TURN);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    destroy_simulation(sim);
+    free((void*)listeners);
+    return elapsed_ns(&start, &end) / fired;
+}
+
+int main(void) {
+    printf("queue,agents,ns_per_event\n");
+    for (int n = 1000; n <= 1000000; n *= 10) {
+        printf("heap,%d,%.1f\n", n, bench(HEAP_QUEUE, n));
+        printf("wheel,%d,%.1f\n", n, bench(WHEEL_QUEUE, n));
+    }
+    return 0;
+}
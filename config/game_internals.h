@@ -1,7 +1,32 @@
 // Internal game configuration
 // Change these only very carefully
 #define TICKS_PER_TURN 1000
+// Scheduler ordering the simulation, HEAP_QUEUE or WHEEL_QUEUE. The wheel
+// orders events due on the same tick differently, so switching changes how
+// a seed plays out.
+#define SIMULATION_QUEUE HEAP_QUEUE
 #define MESSAGE_LENGTH 200
+// Mobs further than this from the player fire less often, taking several steps at once
+#define LOD_NEAR_DISTANCE 12
+#define LOD_MAX_STRETCH 8
+// Firings at full rate after a mob takes damage
+#define LOD_ALERT_FIRINGS 5
+
+// Side of the cells the level buckets mobs and floor items into, which
+// sensory events are published over too
+#define SPATIAL_CELL_SIZE 8
+// Far enough for the player to see across the whole map
+#define PLAYER_SIGHT_RADIUS (MAX_MAP_WIDTH + MAX_MAP_HEIGHT)
+// Mobs further than this from the player never notice it. Mobs have always
+// been able to spot the player from anywhere on the map, so this covers it
+// too, and only bounds the search for mobs that might
+#define MOB_SIGHT_RADIUS PLAYER_SIGHT_RADIUS
+#define DOOR_NOISE_RADIUS 6
+#define SMASH_NOISE_RADIUS 10
+
+// Hunting
+// Mobs more steps than this from the player can't find their way to it
+#define HUNT_DISTANCE 64
 
 // Chemistry
 #define TILE_AIR_REGEN_THRESHOLD 20
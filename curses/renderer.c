@@ -10,6 +10,18 @@
 
 char message_banner[MESSAGE_LENGTH];
 
+// What the terminal shows, and the frame composed to replace it, both
+// column by column. Only the cells that differ between the two are sent.
+static chtype *shown = NULL;
+static chtype *frame = NULL;
+static int frame_rows = 0;
+static int frame_columns = 0;
+static char shown_banner[MESSAGE_LENGTH];
+static bool banner_shown = false;
+
+// Never composed, so cells holding it are always sent
+#define NOT_SHOWN (~(chtype)0)
+
 void init_rendering_system(void) {
     initscr();
 
@@ -32,6 +44,10 @@ void init_rendering_system(void) {
 
 void cleanup_rendering_system(void) {
     endwin();
+    free((void*)shown);
+    free((void*)frame);
+    shown = frame = NULL;
+    frame_rows = frame_columns = 0;
 }
 
 void print_message(char *msg) {
@@ -40,7 +56,26 @@ void print_message(char *msg) {
     strncpy(message_banner, msg, MESSAGE_LENGTH);
 }
 
-static void draw_mobile(mobile *mob, int x_offset, int y_offset) {
+// Size the framebuffers to the map's part of the screen. Whatever was on
+// the terminal before a resize is forgotten and gets sent again.
+static void fit_framebuffers(int rows, int columns) {
+    if (rows == frame_rows && columns == frame_columns) return;
+    int cells = rows * columns > 0 ? rows * columns : 1;
+    free((void*)shown);
+    free((void*)frame);
+    shown = malloc(cells * sizeof(chtype));
+    frame = malloc(cells * sizeof(chtype));
+    if (shown == NULL || frame == NULL) exit(1);
+    for (int i = 0; i < cells; i++) shown[i] = NOT_SHOWN;
+    frame_rows = rows;
+    frame_columns = columns;
+    banner_shown = false;
+    clear();
+}
+
+static void compose_mobile(mobile *mob, int x_offset, int y_offset) {
+    int xx = mob->x + x_offset;
+    int yy = mob->y + y_offset;
     chtype icon = ((item*)mob)->display;
 
     if (mob->emote) {
@@ -48,19 +83,22 @@ static void draw_mobile(mobile *mob, int x_offset, int y_offset) {
         mob->emote = false;
     }
 
-    mvaddch(mob->y + y_offset, mob->x + x_offset, icon);
+    if (0 <= xx && xx < frame_columns && 0 <= yy && yy < frame_rows) {
+        frame[xx * frame_rows + yy] = icon;
+    }
 }
 
 void draw_level(level *lvl) {
     int row,col;
     getmaxyx(stdscr,row,col);
     row -= 1;
+    fit_framebuffers(row, col);
 
     // Offset to keep player in center
     int x_offset = col / 2 - lvl->player->x;
     int y_offset = row / 2 - lvl->player->y;
 
-    // Draw map and items
+    // Compose map and items
     for (int xx = 0; xx < col; xx++) {
         for (int yy = 0; yy < row; yy++) {
             // (xx,yy) are screen coordinates
@@ -71,8 +109,7 @@ void draw_level(level *lvl) {
             chtype icon = TILE_NOT_VISIBLE;
 
             if ((0 <= x && x < lvl->width) && (0 <= y && y < lvl->height)) {
-                //TODO wrapper function with clear name
-                if (can_see(lvl, lvl->player, x, y)) {
+                if (lvl->visible[x][y]) {
                     if (lvl->chemistry[x][y]->elements[fire] > 0) {
                         icon = STATUS_BURNING;
                     } else if (lvl->items[x][y] != NULL) {
@@ -88,23 +125,42 @@ void draw_level(level *lvl) {
                     lvl->memory[x][y] = icon;
                 }
             }
-            mvaddch(yy, xx, icon);
+            frame[xx * row + yy] = icon;
         }
     }
 
-    // Draw mobs
-    for (int i=0; i < lvl->mob_count; i++) {
-        mobile* mob = lvl->mobs[i];
-        if (mob->active && can_see(lvl, lvl->player, mob->x, mob->y)) {
-            if ((0 < mob->y + y_offset && mob->y + y_offset <= row) && (0 < mob->x + x_offset && mob->x + x_offset <= col)) {
-                draw_mobile(mob, x_offset, y_offset);
-            }
+    // Compose mobs, asking the level for just the ones on screen
+    int_vector on_screen;
+    int_vector_init(&on_screen);
+    spatial_index_rect(lvl->mob_index, -x_offset, -y_offset, col - 1 - x_offset, row - 1 - y_offset, &on_screen);
+    for (int i = 0; i < on_screen.length; i++) {
+        mobile* mob = (mobile*)spatial_index_get(lvl->mob_index, on_screen.e[i])->thing;
+        if (mob->active && lvl->visible[mob->x][mob->y]) {
+            compose_mobile(mob, x_offset, y_offset);
         }
     }
-    draw_mobile(lvl->player, x_offset, y_offset);
+    int_vector_free(&on_screen);
+    compose_mobile(lvl->player, x_offset, y_offset);
+
+    // Send what changed and keep the frame as what's shown
+    for (int xx = 0; xx < col; xx++) {
+        for (int yy = 0; yy < row; yy++) {
+            int i = xx * row + yy;
+            if (frame[i] != shown[i]) mvaddch(yy, xx, frame[i]);
+        }
+    }
+    chtype *swap = shown;
+    shown = frame;
+    frame = swap;
+
+    if (!banner_shown || strncmp(shown_banner, message_banner, MESSAGE_LENGTH) != 0) {
+        move(row, 0);
+        clrtoeol();
+        mvprintw(row, 0, message_banner);
+        strncpy(shown_banner, message_banner, MESSAGE_LENGTH);
+        banner_shown = true;
+    }
     move(row, 0);
-    clrtoeol();
-    mvprintw(row, 0, message_banner);
 }
 
 int get_keystroke(void) {
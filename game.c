@@ -136,11 +136,12 @@ void level_step_chemistry(level* lvl) {
     }
 }
 
-void set_options(long int *map_seed, long int *events_seed, bool *reveal_map) {
+void set_options(long int *map_seed, long int *events_seed, bool *reveal_map, int *sim_workers) {
     const char* env_enable_log = getenv("ENABLE_LOG");
     const char* env_map_seed = getenv("MAP_SEED");
     const char* env_events_seed = getenv("EVENTS_SEED");
     const char* env_reveal_map = getenv("REVEAL_MAP");
+    const char* env_sim_workers = getenv("SIM_WORKERS");
 
     if (env_enable_log != NULL) {
         // 'logging_active' is a global variable
@@ -168,6 +169,13 @@ void set_options(long int *map_seed, long int *events_seed, bool *reveal_map) {
         *reveal_map = true;
         logger("Running with map revealed: %s\n", env_reveal_map);
     }
+
+    if (env_sim_workers == NULL) {
+        *sim_workers = 0;
+    } else {
+        *sim_workers = atoi(env_sim_workers);
+        logger("Planning mob turns on %s threads\n", env_sim_workers);
+    }
 }
 
 int main() {
@@ -178,14 +186,21 @@ int main() {
     long int map_seed;
     long int events_seed;
     bool reveal_map;
+    int sim_workers;
 
-    set_options(&map_seed, &events_seed, &reveal_map);
+    set_options(&map_seed, &events_seed, &reveal_map, &sim_workers);
 
     logger("### Starting new game (MAP_SEED=%d EVENTS_SEED=%d) ###\n", map_seed, events_seed);
 
     init_rendering_system();
 
     lvl = make_level(map_seed);
+    if (sim_workers > 0) {
+        simulation_set_workers(lvl->sim, sim_workers);
+    }
+    if (logging_active) {
+        simulation_enable_stats(lvl->sim);
+    }
 
     if (reveal_map) {
         expose_map(lvl);
@@ -200,13 +215,15 @@ int main() {
         logger("=== Turn %3d ===\n", turn + 1);
         turn++;
 
-        sync_simulation(lvl->sim, turn * TICKS_PER_TURN);
+        sync_simulation(lvl->sim, (sim_clock)turn * TICKS_PER_TURN);
+        level_update_vision(lvl);
 
         for (int i=0; i < lvl->mob_count; i++) {
             if (lvl->mobs[i]->active) {
                 step_mobile(lvl, lvl->mobs[i]);
             }
         }
+        level_retire_dead_mobs(lvl);
 
         // Update chemistry model
         level_step_chemistry(lvl);
@@ -231,6 +248,10 @@ int main() {
         get_input(lvl);
     }
 
+    if (logging_active) {
+        dump_sim_stats(simulation_get_stats(lvl->sim), logger);
+    }
+
     destroy_level(lvl);
 
     cleanup_rendering_system();
@@ -10,4 +10,11 @@
 
 #define rand_int(n) (rand() % (n + 1))
 
+// Variants drawing from a caller-owned seed, safe to use off the main thread
+#define frand_r(seed) ((float)rand_r(seed) / RAND_MAX)
+
+#define prob_r(p, seed) (frand_r(seed) <= p)
+
+#define rand_int_r(n, seed) (rand_r(seed) % (n + 1))
+
 #endif
@@ -8,123 +8,156 @@
 #include "../log.h"
 #include "../mob/mob.h"
 #include "../los/los.h"
+#include "../los/fov.h"
+#include "../path/distance_map.h"
+#include "../path/room_graph.h"
+#include "../path/regions.h"
+#include "../simulation/coroutine.h"
+
+// Wander until the player comes into view, then charge for as long as
+// they stay in sight, running down the level's distance map so walls
+// don't stop it. Once it loses sight it makes for where the player was,
+// and only goes back to wandering when it gets there or is stopped. Sight
+// comes from level_update_vision().
+static void minotaur_fire(void *context, void* vmob) {
+    mobile *mob = (mobile*)vmob;
+    level *lvl = (level*)context;
+    struct coroutine *co = &mob->co;
 
-static bool one_step(level *lvl, int *from_x, int *from_y, int to_x, int to_y) {
-    int dx = to_x - *from_x;
-    int dy = to_y - *from_y;
-
-    int x_step, y_step;
+    CO_BEGIN(co);
+    while (true) {
+        while (!mob->sees_player) {
+            random_walk_fire(context, vmob);
+            CO_WAIT_UNTIL(co, random_walk_next_firing(context, vmob, NULL), SENSE(VISION_CHANGE));
+        }
 
-    if (dx > 0) {
-        x_step = 1;
-    } else if (dx < 0) {
-        x_step = -1;
-    } else {
-        x_step = 0;
+        do {
+            if (distance_map_step(lvl->player_distance, lvl, &mob->x, &mob->y)) {
+                spatial_index_move(lvl->mob_index, mob->place, mob->x, mob->y);
+                ((item*) mob)->display = ICON_MINOTAUR_CHARGING;
+            } else {
+                ((item*) mob)->display = EMOTE_ANGRY;
+            }
+            CO_WAIT(co, random_walk_next_firing(context, vmob, NULL));
+        } while (mob->sees_player);
+
+        find_path(lvl->rooms, lvl, mob->x, mob->y, lvl->player->x, lvl->player->y, &mob->route);
+        while (!mob->sees_player && mob->route.length > 0) {
+            int next = int_vector_pop(&mob->route);
+            if (!move_if_valid(lvl, mob, next / lvl->height, next % lvl->height)) {
+                int_vector_clear(&mob->route);
+                break;
+            }
+            CO_WAIT_UNTIL(co, random_walk_next_firing(context, vmob, NULL), SENSE(VISION_CHANGE));
+        }
+        int_vector_clear(&mob->route);
+        ((item*) mob)->display = ICON_MINOTAUR;
     }
+    CO_END(co);
+}
 
-    if (dy > 0) {
-        y_step = 1;
-    } else if (dy < 0) {
-        y_step = -1;
-    } else {
-        y_step = 0;
-    }
+// Wander until dozing off, then sleep until something hurts or wakes it
+static void umber_hulk_fire(void *context, void* vmob) {
+    mobile *mob = (mobile*)vmob;
+    struct coroutine *co = &mob->co;
 
-    int preferred_x, preferred_y;
-    int fallback_x, fallback_y;
-
-    // if the direction is 45 degrees, pick at random
-    if (dx == dy) {
-        // faking (dx,dy) values to feed the selector below
-        if (prob(0.5)) {
-            dx = 1;
-            dy = -1;
-        } else {
-            dy = 1;
-            dx = -1;
+    CO_BEGIN(co);
+    while (true) {
+        while (!prob(UMBERHULK_SLEEP_PROBABILITY)) {
+            random_walk_fire(context, vmob);
+            CO_WAIT(co, random_walk_next_firing(context, vmob, NULL));
         }
-    }
-
-    if (dx > dy) {
-        preferred_x = *from_x + x_step;
-        preferred_y = *from_y;
 
-        fallback_x = *from_x;
-        fallback_y = *from_y + y_step;
-    } else {
-        preferred_x = *from_x;
-        preferred_y = *from_y + y_step;
+        mob->base.display = ICON_UMBER_HULK_ASLEEP;
+        CO_WAIT_ANY(co, SENSE(DAMAGE) | SENSE(NOISE));
+        mob->base.display = ICON_UMBER_HULK_AWAKE;
+    }
+    CO_END(co);
+}
 
-        fallback_x = *from_x + x_step;
-        fallback_y = *from_y;
+// Every mob's agent points at these, which switch on the species tag. The
+// call sites stay monomorphic and the behaviours above inline into them.
+static int species_next_firing(void *context, void* vmob, struct event_listener *listeners) {
+    mobile *mob = (mobile*)vmob;
+    switch (mob->species) {
+        case Player:
+            return every_turn_firing(context, vmob, listeners);
+        case Umberhulk:
+        case Minotaur:
+            return coroutine_next_firing(&mob->co, listeners, mob_wake);
+        default:
+            return random_walk_next_firing(context, vmob, listeners);
     }
+}
 
-    if (is_position_valid(lvl, preferred_x, preferred_y)) {
-        *from_x = preferred_x;
-        *from_y = preferred_y;
-        return true;
-    } else if (is_position_valid(lvl, fallback_x, fallback_y)) {
-        *from_x = fallback_x;
-        *from_y = fallback_y;
-        return true;
-    } else {
-        return false;
+static void species_fire(void *context, void* vmob) {
+    switch (((mobile*)vmob)->species) {
+        case Player:
+            player_move_fire(context, vmob);
+            break;
+        case Umberhulk:
+            umber_hulk_fire(context, vmob);
+            break;
+        case Minotaur:
+            minotaur_fire(context, vmob);
+            break;
+        default:
+            random_walk_fire(context, vmob);
+            break;
     }
 }
 
-static void minotaur_fire(void *context, void* vmob) {
+// Stretch the delay of mobs far from the player and let them cover the
+// lost firings in one go. The stretch is capped so that even with both
+// closing in, the mob fires again before it can come within
+// LOD_NEAR_DISTANCE, and so is promoted back without any polling. Only
+// wandering is stretched: a mob chasing the player, by sight or along a
+// route, moves a tile per firing and would fall behind.
+static int lod_delay(void *context, void* vmob, int delay) {
     mobile *mob = (mobile*)vmob;
     level *lvl = (level*)context;
 
-    if (can_see(lvl, mob, lvl->player->x, lvl->player->y)) {
-        if (one_step(lvl, &mob->x, &mob->y, lvl->player->x, lvl->player->y)) {
-            ((item*) mob)->display = ICON_MINOTAUR_CHARGING;
-        } else {
-            ((item*) mob)->display = EMOTE_ANGRY;
-        }
-    } else {
-        //TODO what does this mob vs. vmob do?
-        random_walk_fire(context, vmob);
+    mob->lod_steps = 1;
+    if (mob == lvl->player || delay <= 0) return delay;
+    if (mob->sees_player || mob->route.length > 0) return delay;
+    if (mob->alert > 0) {
+        mob->alert--;
+        return delay;
     }
-}
 
-static void umber_hulk_fire(void *context, void* vmob) {
-    mobile *mob = (mobile*)vmob;
-    if (prob(UMBERHULK_SLEEP_PROBABILITY)) {
-        if (*(bool*)mob->state) {
-            *(bool*)mob->state = false;
-            mob->base.display = ICON_UMBER_HULK_ASLEEP;
-        } else {
-            *(bool*)mob->state = true;
-            mob->base.display = ICON_UMBER_HULK_AWAKE;
-        }
-    }
+    int dx = abs(mob->x - lvl->player->x);
+    int dy = abs(mob->y - lvl->player->y);
+    int distance = dx > dy ? dx : dy;
+    if (distance <= LOD_NEAR_DISTANCE) return delay;
 
-    if (*(bool*)mob->state) {
-        random_walk_fire(context, vmob);
-    }
-}
+    int stretch = (distance - LOD_NEAR_DISTANCE) * TICKS_PER_TURN / (2 * delay);
+    if (stretch > LOD_MAX_STRETCH) stretch = LOD_MAX_STRETCH;
+    if (stretch <= 1) return delay;
 
-static bool umber_hulk_invalidation(void *vmob) {
-    mobile *mob = (mobile*)vmob;
-    *(bool*)mob->state = true;
-    mob->base.display = ICON_UMBER_HULK_AWAKE;
-    return true;
+    mob->lod_steps = stretch;
+    return delay * stretch;
 }
 
-static int umber_hulk_next_firing(void *context, void* vmob, struct event_listener *listeners) {
-    mobile *mob = (mobile*)vmob;
-    if (*(bool*)mob->state) {
-        float rate = 0.5; //TODO magic number
-        float r = frand();
-        int next_fire = log(1-r)/(-rate) * TICKS_PER_TURN;
-        if (next_fire < TICKS_PER_TURN) return TICKS_PER_TURN;
-        return next_fire;
+static agent_handle push_mob_agent(level *lvl, mobile *mob) {
+    struct agent a;
+    a.state = (void*)mob;
+    a.kind = mob->species;
+    a.next_firing = species_next_firing;
+    a.fire = species_fire;
+    if (mob->species == Goblin || mob->species == Orc) {
+        a.plan = random_walk_plan;
+        a.apply = step_apply;
     } else {
-        listeners[DAMAGE].handler = umber_hulk_invalidation;
-        return INT_MAX;
+        // The player acts on input and coroutine behaviours keep their
+        // place between firings, so they fire serially
+        a.plan = NULL;
+        a.apply = NULL;
     }
+    a.listeners = ((item*)mob)->listeners;
+    agent_handle handle = simulation_push_agent(lvl->sim, &a);
+    mob->place = spatial_index_insert(lvl->mob_index, (void*)mob, mob->x, mob->y);
+    sensory_bus_subscribe(lvl->senses, mob->place, handle, ((item*)mob)->listeners);
+    return handle;
 }
 
 static void make_map(level *lvl);
@@ -154,6 +187,9 @@ level* make_level(long int map_seed) {
     lvl->memory = malloc(lvl->width * sizeof(int*));
     lvl->memory[0] = malloc(lvl->height * lvl->width * sizeof(int));
 
+    lvl->visible = malloc(lvl->width * sizeof(bool*));
+    lvl->visible[0] = malloc(lvl->height * lvl->width * sizeof(bool));
+
     lvl->items = malloc(lvl->width * sizeof(inventory_item**));
     lvl->items[0] = malloc(lvl->height * lvl->width * sizeof(inventory_item*));
 
@@ -164,6 +200,7 @@ level* make_level(long int map_seed) {
     for (int x = 1; x < lvl->width; x++) {
         lvl->tiles[x] = lvl->tiles[0] + x * lvl->height;
         lvl->memory[x] = lvl->memory[0] + x * lvl->height;
+        lvl->visible[x] = lvl->visible[0] + x * lvl->height;
         lvl->items[x] = lvl->items[0] + x * lvl->height;
         lvl->chemistry[x] = lvl->chemistry[0] + x * lvl->height;
     }
@@ -173,6 +210,7 @@ level* make_level(long int map_seed) {
         for (int y = 0; y < lvl->height; y++) {
             lvl->tiles[x][y] = TILE_FLOOR;
             lvl->memory[x][y] = TILE_NOT_VISIBLE;
+            lvl->visible[x][y] = false;
             lvl->items[x][y] = NULL;
 
             lvl->chemistry[x][y] = make_constituents();
@@ -182,20 +220,28 @@ level* make_level(long int map_seed) {
 
     lvl->chem_sys = make_default_chemical_system();
 
-    lvl->sim = make_simulation((void*)lvl);
+    lvl->terrain_version = 0;
+    lvl->sight_cache = make_los_cache();
+    lvl->player_distance = NULL;
+
+    lvl->sim = make_simulation_with_queue((void*)lvl, SIMULATION_QUEUE, TICKS_PER_TURN);
+    simulation_set_lod(lvl->sim, lod_delay);
+    lvl->mob_index = make_spatial_index(lvl->width, lvl->height, SPATIAL_CELL_SIZE);
+    lvl->senses = make_sensory_bus(lvl->mob_index);
+    lvl->item_index = make_spatial_index(lvl->width, lvl->height, SPATIAL_CELL_SIZE);
+    agent_handle_vector_init(&lvl->watchers);
+    agent_handle_vector_init(&lvl->next_watchers);
+    lvl->vision_pass = 0;
 
     //TODO have make_map() return the starting coords for the player based on root room
     make_map(lvl);
 
     lvl->player = lvl->mobs[lvl->mob_count-1];
     lvl->player->x = lvl->player->y = 1;
-    struct agent a;
-
-    a.next_firing = every_turn_firing;
-    a.fire = player_move_fire;
-    a.state = (void*)lvl->player;
-    a.listeners = ((item*)lvl->player)->listeners;
-    simulation_push_agent(lvl->sim, &a);
+    lvl->player->species = Player;
+    lvl->player->agent = push_mob_agent(lvl, lvl->player);
+    lvl->player_distance = make_distance_map(lvl, HUNT_DISTANCE);
+    distance_map_add_goal(lvl->player_distance, lvl, lvl->player->x, lvl->player->y);
 
     ((item*)lvl->player)->health = 10;
     ((item*)lvl->player)->display = ICON_PLAYER;
@@ -244,67 +290,50 @@ level* make_level(long int map_seed) {
         int y = 0;
 
         while (lvl->tiles[x][y] != TILE_FLOOR) {
-            x = rand_int(lvl->width);
-            y = rand_int(lvl->height);
+            x = rand_int(lvl->width - 1);
+            y = rand_int(lvl->height - 1);
         }
 
         lvl->mobs[i]->x = x;
         lvl->mobs[i]->y = y;
         lvl->mobs[i]->active = true;
+        lvl->mobs[i]->seed = (unsigned int)map_seed + i + 1;
 
-        switch (rand_int(NUM_MONSTER_TYPES - 1)) {
+        lvl->mobs[i]->species = rand_int(NUM_MONSTER_TYPES - 1);
+        switch (lvl->mobs[i]->species) {
             case Goblin:
                 ((item*)lvl->mobs[i])->display = ICON_GOBLIN;
                 lvl->mobs[i]->stacks = true;
                 ((item*)lvl->mobs[i])->name = malloc(sizeof(char)*7);
-                a.next_firing = random_walk_next_firing;
-                a.fire = random_walk_fire;
-                a.state = (void*)lvl->mobs[i];
-                a.listeners = ((item*)lvl->mobs[i])->listeners;
-                simulation_push_agent(lvl->sim, &a);
                 strcpy(((item*)lvl->mobs[i])->name, "goblin");
                 break;
             case Orc:
                 ((item*)lvl->mobs[i])->display = ICON_ORC;
                 ((item*)lvl->mobs[i])->name = malloc(sizeof(char)*4);
-                a.next_firing = random_walk_next_firing;
-                a.fire = random_walk_fire;
-                a.state = (void*)lvl->mobs[i];
-                a.listeners = ((item*)lvl->mobs[i])->listeners;
-                simulation_push_agent(lvl->sim, &a);
                 strcpy(((item*)lvl->mobs[i])->name, "orc");
                 break;
             case Umberhulk:
                 ((item*)lvl->mobs[i])->display = ICON_UMBER_HULK_AWAKE;
-                ((item*)lvl->mobs[i])->name = malloc(sizeof(char)*4);
+                ((item*)lvl->mobs[i])->name = malloc(sizeof(char)*10);
                 ((item*)lvl->mobs[i])->health = 30;
-                lvl->mobs[i]->state = malloc(sizeof(bool));
-                *(bool*)lvl->mobs[i]->state = true;
-                a.next_firing = umber_hulk_next_firing;
-                a.fire = umber_hulk_fire;
-                a.state = (void*)lvl->mobs[i];
-                a.listeners = ((item*)lvl->mobs[i])->listeners;
-                simulation_push_agent(lvl->sim, &a);
                 strcpy(((item*)lvl->mobs[i])->name, "umberhulk");
                 break;
             case Minotaur:
                 ((item*)lvl->mobs[i])->display = ICON_MINOTAUR;
                 ((item*)lvl->mobs[i])->name = malloc(sizeof(char)*9);
-                a.next_firing = random_walk_next_firing;
-                a.fire = minotaur_fire;
-                a.state = (void*)lvl->mobs[i];
-                a.listeners = ((item*)lvl->mobs[i])->listeners;
-                simulation_push_agent(lvl->sim, &a);
                 strcpy(((item*)lvl->mobs[i])->name, "minotaur");
                 break;
             default:
                 logger("Fell through to 'default' in monster selection switch statement\n");
                 break;
         }
+        lvl->mobs[i]->agent = push_mob_agent(lvl, lvl->mobs[i]);
     }
-    for (int i = 0; i < lvl->mob_count; i++) {
-        schedule_event(lvl->sim, (struct agent*)vector_get(lvl->sim->agents, i), 0);
+    schedule_event(lvl->sim, lvl->player->agent, 0);
+    for (int i = 0; i < lvl->mob_count-1; i++) {
+        schedule_event(lvl->sim, lvl->mobs[i]->agent, 0);
     }
+    level_update_vision(lvl);
 
     return lvl;
 }
@@ -314,6 +343,8 @@ void destroy_level(level *lvl) {
     free((void *)lvl->tiles);
     free((void *)lvl->memory[0]);
     free((void *)lvl->memory);
+    free((void *)lvl->visible[0]);
+    free((void *)lvl->visible);
     free((void *)lvl->items[0]);
     free((void *)lvl->items);
     for (int x = 0; x < lvl->width; x++) for (int y = 0; y < lvl->height; y++) {
@@ -322,12 +353,93 @@ void destroy_level(level *lvl) {
     free((void *)lvl->chemistry[0]);
     free((void *)lvl->chemistry);
     destroy_chemical_system(lvl->chem_sys);
+    destroy_los_cache(lvl->sight_cache);
+    destroy_distance_map(lvl->player_distance);
+    destroy_regions(lvl->regions);
+    destroy_room_graph(lvl->rooms);
     for (int i = 0; i < lvl->mob_count; i++) destroy_mob(lvl->mobs[i]);
     free((void *)lvl->mobs);
     destroy_simulation(lvl->sim);
+    destroy_sensory_bus(lvl->senses);
+    destroy_spatial_index(lvl->mob_index);
+    destroy_spatial_index(lvl->item_index);
+    agent_handle_vector_free(&lvl->watchers);
+    agent_handle_vector_free(&lvl->next_watchers);
     free((void *)lvl);
 }
 
+// Take dead mobs out of the simulation and the mobs array, leaving what
+// they carried on the floor. The player stays put so the game can end.
+void level_retire_dead_mobs(level *lvl) {
+    int i = 0;
+    while (i < lvl->mob_count) {
+        mobile *mob = lvl->mobs[i];
+        if (mob->active || mob == lvl->player) {
+            i++;
+            continue;
+        }
+
+        simulation_retire_agent(lvl->sim, mob->agent);
+        sensory_bus_unsubscribe(lvl->senses, mob->place);
+        spatial_index_remove(lvl->mob_index, mob->place);
+        item *itm;
+        while ((itm = pop_inventory(mob)) != NULL) {
+            level_push_item(lvl, itm, mob->x, mob->y);
+        }
+        destroy_mob(mob);
+
+        // Keep the array dense, order doesn't matter
+        lvl->mob_count--;
+        lvl->mobs[i] = lvl->mobs[lvl->mob_count];
+    }
+}
+
+static void tell_vision_change(level *lvl, mobile *mob, bool sees_player) {
+    mob->sees_player = sees_player;
+    struct event_listener *listener = &((item*)mob)->listeners[VISION_CHANGE];
+    if (listener->handler != NULL) {
+        simulation_call_event_handler(lvl->sim, listener);
+    }
+}
+
+static void look_for_player(void *context, struct subscriber *s) {
+    level *lvl = (level*)context;
+    struct agent *a = simulation_get_agent(lvl->sim, s->agent);
+    if (a == NULL || a->state == (void*)lvl->player) return;
+
+    mobile *mob = (mobile*)a->state;
+    bool sees_player = mob_sees_player(lvl, mob);
+    mob->vision_pass = lvl->vision_pass;
+    if (sees_player != mob->sees_player) tell_vision_change(lvl, mob, sees_player);
+    if (sees_player) agent_handle_vector_push(&lvl->next_watchers, s->agent);
+}
+
+// Recompute what the player can see, then work out which mobs
+// gained or lost sight of the player since the last pass and send
+// VISION_CHANGE to just those. Only mobs within MOB_SIGHT_RADIUS are
+// looked at, plus the ones that could see last time.
+void level_update_vision(level *lvl) {
+    compute_fov(lvl, lvl->player->x, lvl->player->y, PLAYER_SIGHT_RADIUS, FOV_SYMMETRIC, lvl->visible);
+
+    lvl->vision_pass++;
+    agent_handle_vector_clear(&lvl->next_watchers);
+    sensory_bus_visit(lvl->senses, lvl->player->x, lvl->player->y, MOB_SIGHT_RADIUS, look_for_player, (void*)lvl);
+
+    // Watchers the search didn't reach have wandered out of range
+    for (int i = 0; i < lvl->watchers.length; i++) {
+        struct agent *a = simulation_get_agent(lvl->sim, lvl->watchers.e[i]);
+        if (a == NULL) continue;
+        mobile *mob = (mobile*)a->state;
+        if (mob->vision_pass != lvl->vision_pass && mob->sees_player) {
+            tell_vision_change(lvl, mob, false);
+        }
+    }
+
+    agent_handle_vector swap = lvl->watchers;
+    lvl->watchers = lvl->next_watchers;
+    lvl->next_watchers = swap;
+}
+
 static int partition(int **room_map, int x, int y, int w, int h, int rm) {
     if (w*h > 10*10 && prob(PARTITIONING_PROBABILITY)) { //TODO magic numbers
         int hw = w/2;
@@ -355,13 +467,19 @@ static int partition(int **room_map, int x, int y, int w, int h, int rm) {
 
 static void make_map(level *lvl) {
     int **room_tiles = malloc(lvl->width * sizeof(int*));
-    for (int i = 0; i != lvl->width; i++) {
-        room_tiles[i] = malloc(lvl->height*sizeof(int));
-    }
+    room_tiles[0] = malloc(lvl->height * lvl->width * sizeof(int));
+
+    int **potential_doors = malloc(lvl->width * sizeof(int*));
+    potential_doors[0] = malloc(lvl->height * lvl->width * sizeof(int));
 
-    int **potential_doors= malloc(lvl->width * sizeof(int*));
-    for (int i = 0; i != lvl->width; i++) {
-        potential_doors[i] = malloc(lvl->height*sizeof(int));
+    for (int x = 1; x < lvl->width; x++) {
+        room_tiles[x] = room_tiles[0] + x * lvl->height;
+        potential_doors[x] = potential_doors[0] + x * lvl->height;
+    }
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            potential_doors[x][y] = false;
+        }
     }
 
     int max_room_id = partition(room_tiles, 0, 0, lvl->width, lvl->height, 0);
@@ -390,15 +508,15 @@ static void make_map(level *lvl) {
     }
 
     // whether each room is accessible from the "root" room
-    bool room_connected[max_room_id];
+    bool room_connected[max_room_id + 1];
 
-    for (int i = 0; i < max_room_id; i++) {
+    for (int i = 0; i <= max_room_id; i++) {
         room_connected[i] = false;
     }
 
     // determine the "root" room
-    int rand_x = rand_int(lvl->width) + 1;
-    int rand_y = rand_int(lvl->height) + 1;
+    int rand_x = rand_int(lvl->width - 3) + 1;
+    int rand_y = rand_int(lvl->height - 3) + 1;
 
     room_connected[room_tiles[rand_x][rand_y]] = true;
 
@@ -433,6 +551,9 @@ static void make_map(level *lvl) {
         }
     }
 
+    lvl->rooms = make_room_graph(lvl, room_tiles, max_room_id);
+    lvl->regions = make_regions(lvl->rooms, lvl);
+
     free((void *)room_tiles[0]);
     free((void *)room_tiles);
     free((void *)potential_doors[0]);
@@ -443,6 +564,7 @@ void level_push_item(level *lvl, item *itm, int x, int y) {
     inventory_item *new_inv = malloc(sizeof(inventory_item));
     new_inv->next = NULL;
     new_inv->item = itm;
+    new_inv->place = spatial_index_insert(lvl->item_index, (void*)itm, x, y);
     if (lvl->items[x][y] == NULL) {
         lvl->items[x][y] = new_inv;
     } else {
@@ -458,6 +580,7 @@ item* level_pop_item(level *lvl, int x, int y) {
     } else {
         inventory_item *old = lvl->items[x][y];
         lvl->items[x][y] = old->next;
+        spatial_index_remove(lvl->item_index, old->place);
         item *itm = old-> item;
         free(old);
         return itm;
@@ -485,10 +608,33 @@ bool is_position_valid(level *lvl, int x, int y) {
     return true;
 }
 
+// Note that the tile at (x, y) started or stopped blocking sight and the way
+void level_terrain_changed(level *lvl, int x, int y) {
+    struct terrain_edit *edit = &lvl->terrain_edits[lvl->terrain_version % TERRAIN_EDIT_LOG];
+    edit->x = x;
+    edit->y = y;
+    lvl->terrain_version++;
+    if (lvl->player_distance != NULL) distance_map_terrain_changed(lvl->player_distance, lvl, x, y);
+    regions_door_toggled(lvl->regions, lvl, x, y);
+}
+
+// Whether any tile in the box from (x0, y0) to (x1, y1) changed since the
+// given terrain version. A version too old to tell counts as a change.
+bool terrain_changed_within(level *lvl, int since_version, int x0, int y0, int x1, int y1) {
+    if (lvl->terrain_version - since_version > TERRAIN_EDIT_LOG) return true;
+    for (int v = since_version; v < lvl->terrain_version; v++) {
+        struct terrain_edit *edit = &lvl->terrain_edits[v % TERRAIN_EDIT_LOG];
+        if (x0 <= edit->x && edit->x <= x1 && y0 <= edit->y && edit->y <= y1) return true;
+    }
+    return false;
+}
+
 bool move_if_valid(level *lvl, mobile *mob, int x, int y) {
     if (is_position_valid(lvl, x, y)) {
+        if (mob == lvl->player) distance_map_move_goal(lvl->player_distance, lvl, mob->x, mob->y, x, y);
         mob->x = x;
         mob->y = y;
+        if (mob->place >= 0) spatial_index_move(lvl->mob_index, mob->place, x, y);
         return true;
     } else {
         return false;
@@ -8,15 +8,53 @@
 #include "../mob/mob.h"
 #include "../chemistry/chemistry.h"
 #include "../simulation/simulation.h"
+#include "../simulation/sensory_bus.h"
+#include "../simulation/spatial_index.h"
+
+// How many recent terrain changes a level remembers the position of
+#define TERRAIN_EDIT_LOG 64
+
+struct terrain_edit {
+    int x;
+    int y;
+};
+
+struct los_cache;
+struct distance_map;
+struct room_graph;
+struct regions;
 
 typedef struct Level {
     chtype **tiles; // ncurses type: char with attributes
     chtype **memory;
+    // Cells the player could see at the last vision pass
+    bool **visible;
+    // Bumped whenever a tile starts or stops blocking sight. Change v
+    // happened at terrain_edits[v % TERRAIN_EDIT_LOG].
+    int terrain_version;
+    struct terrain_edit terrain_edits[TERRAIN_EDIT_LOG];
+    struct los_cache *sight_cache;
+    // Steps to the player, kept up to date as it moves and doors toggle
+    struct distance_map *player_distance;
+    // The rooms and doors make_map() laid out, for finding paths
+    struct room_graph *rooms;
+    // Which rooms are joined up through open doors
+    struct regions *regions;
     inventory_item ***items;
     constituents ***chemistry;
     chemical_system *chem_sys;
     int keyboard_x, keyboard_y;
     struct simulation *sim;
+    // Where the mobs and the items on the floor are, for finding what's
+    // near a spot without going through them all
+    struct spatial_index *mob_index;
+    struct spatial_index *item_index;
+    // Mobs' listeners, over their entries in mob_index
+    struct sensory_bus *senses;
+    // Agents of mobs that could see the player at the last vision pass
+    agent_handle_vector watchers;
+    agent_handle_vector next_watchers;
+    int vision_pass;
     int width;
     int height;
     mobile **mobs;
@@ -27,12 +65,22 @@ typedef struct Level {
 
 level* make_level(long int map_seed);
 void destroy_level(level *lvl);
+void level_retire_dead_mobs(level *lvl);
+void level_update_vision(level *lvl);
 
 void level_push_item(level *lvl, item *itm, int x, int y);
 item* level_pop_item(level *lvl, int x, int y);
 
 bool is_position_valid(level *lvl, int x, int y);
+void level_terrain_changed(level *lvl, int x, int y);
+bool terrain_changed_within(level *lvl, int since_version, int x0, int y0, int x1, int y1);
 bool move_if_valid(level *lvl, mobile *mob, int x, int y);
 void expose_map(level *lvl);
 
+// Whether the tile blocks sight. Unlike is_position_valid() mobs don't.
+// Inline because line walks call it for every cell.
+static inline bool is_opaque(level *lvl, int x, int y) {
+    return lvl->tiles[x][y] == TILE_WALL || lvl->tiles[x][y] == DOOR_CLOSED;
+}
+
 #endif
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fov.h"
+
+// Where the scans mark what they see, either a whole-map grid or a
+// viewer's bitset
+struct fov_out {
+    bool **grid;
+    struct viewer_fov *fov;
+};
+
+static inline void mark(struct fov_out *out, int x, int y) {
+    if (out->grid != NULL) {
+        out->grid[x][y] = true;
+    } else {
+        struct viewer_fov *fov = out->fov;
+        int i = (y - fov->y0) * fov->width + (x - fov->x0);
+        fov->bits[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+}
+
+// Recursive shadowcasting. Each octant is scanned row by row outwards from
+// the origin, keeping the slopes between start and end that are still lit.
+// An opaque cell narrows the lit range for the rows behind it, and a run of
+// them splits the scan so the part beyond the run carries on separately.
+// Every cell is visited at most once per octant.
+
+// Maps the octant's (column, row) onto map offsets
+static const int octants[8][4] = {
+    { 1,  0,  0,  1},
+    { 0,  1,  1,  0},
+    { 0, -1,  1,  0},
+    {-1,  0,  0,  1},
+    {-1,  0,  0, -1},
+    { 0, -1, -1,  0},
+    { 0,  1, -1,  0},
+    { 1,  0,  0, -1},
+};
+
+static void cast_light(level *lvl, struct fov_out *out, int origin_x, int origin_y, int radius,
+        int row, double start, double end, const int *octant) {
+    if (start < end) return;
+
+    double next_start = start;
+    for (int j = row; j <= radius; j++) {
+        bool blocked = false;
+        // Rows run away from the origin along negative offsets
+        int dj = -j;
+        for (int i = -j; i <= 0; i++) {
+            // Slopes of the cell's two corners as seen from the origin
+            double left = (i - 0.5) / (dj + 0.5);
+            double right = (i + 0.5) / (dj - 0.5);
+            if (start < right) continue;
+            if (end > left) break;
+
+            int x = origin_x + i * octant[0] + dj * octant[1];
+            int y = origin_y + i * octant[2] + dj * octant[3];
+            bool on_map = 0 <= x && x < lvl->width && 0 <= y && y < lvl->height;
+            if (on_map && i*i + j*j <= radius*radius) mark(out, x, y);
+
+            bool opaque = !on_map || is_opaque(lvl, x, y);
+            if (blocked) {
+                if (opaque) {
+                    next_start = right;
+                } else {
+                    blocked = false;
+                    start = next_start;
+                }
+            } else if (opaque && j < radius) {
+                blocked = true;
+                cast_light(lvl, out, origin_x, origin_y, radius, j + 1, start, left, octant);
+                next_start = right;
+            }
+        }
+        if (blocked) break;
+    }
+}
+
+// Symmetric shadowcasting, after Albert Ford. Each quadrant is scanned row
+// by row between a start and an end slope. A floor tile is only lit when
+// its centre lies inside the slopes, which is what makes sight symmetric,
+// while walls are lit whenever any part of them is. Slopes are kept as
+// exact fractions so that rounding can't break the symmetry.
+
+struct slope {
+    int num;
+    int den; // always positive
+};
+
+// Maps the quadrant's (depth, column) onto map offsets
+static const int quadrants[4][4] = {
+    { 0,  1, -1,  0}, // north
+    { 0,  1,  1,  0}, // south
+    { 1,  0,  0,  1}, // east
+    {-1,  0,  0,  1}, // west
+};
+
+static int floor_div(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Which tile a quadrant's (depth, column) lands on, false if off the map
+static bool quadrant_tile(level *lvl, int origin_x, int origin_y, const int *q, int depth, int col, int *x, int *y) {
+    *x = origin_x + depth * q[0] + col * q[1];
+    *y = origin_y + depth * q[2] + col * q[3];
+    return 0 <= *x && *x < lvl->width && 0 <= *y && *y < lvl->height;
+}
+
+static void scan_row(level *lvl, struct fov_out *out, int origin_x, int origin_y, int radius,
+        const int *q, int depth, struct slope start, struct slope end) {
+    if (depth > radius) return;
+
+    // Columns whose centres round into the slopes, ties towards the middle
+    int min_col = floor_div(2 * depth * start.num + start.den, 2 * start.den);
+    int max_col = -floor_div(-(2 * depth * end.num - end.den), 2 * end.den);
+
+    // -1 before the first tile, then whether the previous tile was a wall
+    int prev_wall = -1;
+    for (int col = min_col; col <= max_col; col++) {
+        int x, y;
+        bool on_map = quadrant_tile(lvl, origin_x, origin_y, q, depth, col, &x, &y);
+        bool wall = !on_map || is_opaque(lvl, x, y);
+        bool centre_inside = col * start.den >= depth * start.num && col * end.den <= depth * end.num;
+
+        if (on_map && (wall || centre_inside) && depth*depth + col*col <= radius*radius) {
+            mark(out, x, y);
+        }
+
+        // Slope through the tile's near edge on the start side
+        struct slope edge = { 2 * col - 1, 2 * depth };
+        if (prev_wall == 1 && !wall) start = edge;
+        if (prev_wall == 0 && wall) scan_row(lvl, out, origin_x, origin_y, radius, q, depth + 1, start, edge);
+        prev_wall = wall;
+    }
+    if (prev_wall == 0) scan_row(lvl, out, origin_x, origin_y, radius, q, depth + 1, start, end);
+}
+
+static void cast(level *lvl, struct fov_out *out, int origin_x, int origin_y, int radius, enum fov_mode mode) {
+    mark(out, origin_x, origin_y);
+    switch (mode) {
+        case FOV_SHADOWCAST:
+            for (int i = 0; i < 8; i++) {
+                cast_light(lvl, out, origin_x, origin_y, radius, 1, 1.0, 0.0, octants[i]);
+            }
+            break;
+        case FOV_SYMMETRIC:
+            for (int i = 0; i < 4; i++) {
+                struct slope start = { -1, 1 };
+                struct slope end = { 1, 1 };
+                scan_row(lvl, out, origin_x, origin_y, radius, quadrants[i], 1, start, end);
+            }
+            break;
+    }
+}
+
+// Mark every cell within radius that can be seen from the origin, clearing
+// the rest. Walls and closed doors are seen but block what lies behind them.
+void compute_fov(level *lvl, int origin_x, int origin_y, int radius, enum fov_mode mode, bool **visible) {
+    struct fov_out out = { .grid = visible, .fov = NULL };
+    memset((void*)visible[0], 0, lvl->width * lvl->height * sizeof(bool));
+    cast(lvl, &out, origin_x, origin_y, radius, mode);
+}
+
+void init_viewer_fov(struct viewer_fov *fov) {
+    fov->version = -1;
+    fov->stale = false;
+    fov->bits = NULL;
+    fov->capacity = 0;
+}
+
+void free_viewer_fov(struct viewer_fov *fov) {
+    free((void*)fov->bits);
+    init_viewer_fov(fov);
+}
+
+// Whether the viewer's bits still hold for where it stands now
+static bool viewer_fov_current(level *lvl, struct viewer_fov *fov, int x, int y, int radius, enum fov_mode mode) {
+    if (fov->version < 0 || fov->x != x || fov->y != y || fov->radius != radius || fov->mode != (int)mode) return false;
+    return !terrain_changed_within(lvl, fov->version, fov->x0, fov->y0, fov->x0 + fov->width - 1, fov->y0 + fov->height - 1);
+}
+
+static void compute_viewer_fov(level *lvl, struct viewer_fov *fov) {
+    fov->x0 = fov->x - fov->radius > 0 ? fov->x - fov->radius : 0;
+    fov->y0 = fov->y - fov->radius > 0 ? fov->y - fov->radius : 0;
+    int x1 = fov->x + fov->radius < lvl->width ? fov->x + fov->radius : lvl->width - 1;
+    int y1 = fov->y + fov->radius < lvl->height ? fov->y + fov->radius : lvl->height - 1;
+    fov->width = x1 - fov->x0 + 1;
+    fov->height = y1 - fov->y0 + 1;
+
+    int words = (fov->width * fov->height + 63) / 64;
+    if (words > fov->capacity) {
+        fov->bits = realloc(fov->bits, words * sizeof(uint64_t));
+        if (fov->bits == NULL) exit(1);
+        fov->capacity = words;
+    }
+    memset((void*)fov->bits, 0, words * sizeof(uint64_t));
+
+    struct fov_out out = { .grid = NULL, .fov = fov };
+    cast(lvl, &out, fov->x, fov->y, fov->radius, (enum fov_mode)fov->mode);
+}
+
+struct fov_batch {
+    level *lvl;
+    struct viewer_fov **viewers;
+};
+
+static void fov_task(void *vbatch, int i) {
+    struct fov_batch *batch = (struct fov_batch*)vbatch;
+    struct viewer_fov *fov = batch->viewers[i];
+    if (fov->stale) compute_viewer_fov(batch->lvl, fov);
+    fov->stale = false;
+}
+
+// Bring each viewer's field of view up to date, with viewers[i] looking
+// out from (xs[i], ys[i]). Viewers that haven't moved and whose box of
+// terrain hasn't changed are kept, the rest are computed on the pool,
+// which may be NULL. Scans only read the level, so they can run side by
+// side.
+void compute_fovs(level *lvl, struct worker_pool *pool, struct viewer_fov **viewers, const int *xs, const int *ys,
+        int count, int radius, enum fov_mode mode) {
+    for (int i = 0; i < count; i++) {
+        struct viewer_fov *fov = viewers[i];
+        fov->stale = !viewer_fov_current(lvl, fov, xs[i], ys[i], radius, mode);
+        fov->x = xs[i];
+        fov->y = ys[i];
+        fov->radius = radius;
+        fov->mode = mode;
+        fov->version = lvl->terrain_version;
+    }
+
+    struct fov_batch batch = { .lvl = lvl, .viewers = viewers };
+    worker_pool_run(pool, fov_task, (void*)&batch, count);
+}
@@ -0,0 +1,19 @@
+#ifndef INC_FOV_H
+#define INC_FOV_H
+
+#include <stdbool.h>
+#include "../level/level.h"
+#include "viewer_fov.h"
+
+enum fov_mode {
+    // Recursive shadowcasting, lights a little more wall around corners
+    FOV_SHADOWCAST,
+    // A floor tile sees another exactly when the other sees it back
+    FOV_SYMMETRIC,
+};
+
+void compute_fov(level *lvl, int origin_x, int origin_y, int radius, enum fov_mode mode, bool **visible);
+void compute_fovs(level *lvl, struct worker_pool *pool, struct viewer_fov **viewers, const int *xs, const int *ys,
+        int count, int radius, enum fov_mode mode);
+
+#endif
@@ -1,78 +1,194 @@
 #include "los.h"
 
 //TODO make a mob-to-mob LOS function
-//TODO make a player-can-see function
 
-static bool check_line(level *lvl, int origin_x, int origin_y, int target_x, int target_y, checker_func checker) {
-    int cur_x = origin_x;
-    int cur_y = origin_y;
-
-    int dx = abs(target_x - origin_x);
-    int dy = abs(target_y - origin_y);
-
-    int x_increment = (target_x >= origin_x) ? 1 : -1;
-    int y_increment = (target_y >= origin_y) ? 1 : -1;
-
-    int *rise, *run;
-    int *stepper, *step;
-    int *bumper, *bump;
-
-    //TODO Should 45 degrees be shallow or steep?
-    if (dx > dy) {
-        // shallow slope - step along X-axis
-        rise = &dy;
-        run = &dx;
-
-        stepper = &cur_x;
-        step = &x_increment;
+// Bresenham stepping from the origin towards an offset. Shallow lines
+// step along X and bump Y, steep ones (45 degrees included) the other way
+// round. The target is reached after as many steps as the longer axis.
+struct line_walk {
+    int x, y;
+    int run, rise;
+    int x_step, y_step;
+    bool shallow;
+    int debt;
+};
+
+static inline void line_start(struct line_walk *w, int x, int y, int dx, int dy) {
+    w->x = x;
+    w->y = y;
+    w->x_step = dx >= 0 ? 1 : -1;
+    w->y_step = dy >= 0 ? 1 : -1;
+    dx = abs(dx);
+    dy = abs(dy);
+    w->shallow = dx > dy;
+    w->run = w->shallow ? dx : dy;
+    w->rise = w->shallow ? dy : dx;
+    w->debt = 0;
+}
 
-        bumper = &cur_y;
-        bump = &y_increment;
+static inline void line_next(struct line_walk *w) {
+    w->debt += w->rise;
+    bool bump = w->debt >= w->run;
+    if (bump) w->debt -= w->run;
+    if (w->shallow) {
+        w->x += w->x_step;
+        if (bump) w->y += w->y_step;
     } else {
-        // steep slope - step along Y-axis
-        rise = &dx;
-        run = &dy;
-
-        stepper = &cur_y;
-        step = &y_increment;
-
-        bumper = &cur_x;
-        bump = &x_increment;
+        w->y += w->y_step;
+        if (bump) w->x += w->x_step;
     }
+}
 
-    int bump_debt = 0;
-
-    while (true) {
-        if (dx == 0) {
-            // exception case - vertical line
-            cur_y += y_increment;
-        } else if (dy == 0) {
-            // exception case - horizontal line
-            cur_x += x_increment;
-        } else {
-            *stepper += *step;
-            bump_debt += *rise;
-
-            if (bump_debt >= *run) {
-                *bumper += *bump;
-                bump_debt -= *run;
+// Every line from the origin to an offset within LOS_RAY_RADIUS, as the
+// offsets of the cells it crosses between its two ends
+#define RAY_SPAN (2*LOS_RAY_RADIUS + 1)
+
+struct ray_step {
+    signed char dx;
+    signed char dy;
+};
+
+struct ray {
+    int first;
+    int length;
+};
+
+static struct ray rays[RAY_SPAN * RAY_SPAN];
+static struct ray_step ray_steps[RAY_SPAN * RAY_SPAN * LOS_RAY_RADIUS];
+static bool rays_ready = false;
+
+static void build_rays(void) {
+    int next = 0;
+    for (int dy = -LOS_RAY_RADIUS; dy <= LOS_RAY_RADIUS; dy++) {
+        for (int dx = -LOS_RAY_RADIUS; dx <= LOS_RAY_RADIUS; dx++) {
+            struct ray *r = &rays[(dy + LOS_RAY_RADIUS) * RAY_SPAN + dx + LOS_RAY_RADIUS];
+            struct line_walk w;
+            r->first = next;
+            r->length = 0;
+            line_start(&w, 0, 0, dx, dy);
+            for (int i = 1; i < w.run; i++) {
+                line_next(&w);
+                ray_steps[next].dx = w.x;
+                ray_steps[next].dy = w.y;
+                next++;
+                r->length++;
             }
         }
+    }
+    rays_ready = true;
+}
 
-        if (cur_x == target_x && cur_y == target_y) {
-            return true;
+// Find the first opaque cell strictly between the two ends, returning
+// false if there is none. Both ends must be on the map, which keeps every
+// cell in between on it too.
+static inline bool find_blocker(level *lvl, int origin_x, int origin_y, int target_x, int target_y, int *blocker_x, int *blocker_y) {
+    int dx = target_x - origin_x;
+    int dy = target_y - origin_y;
+
+    if (abs(dx) <= LOS_RAY_RADIUS && abs(dy) <= LOS_RAY_RADIUS) {
+        const struct ray *r = &rays[(dy + LOS_RAY_RADIUS) * RAY_SPAN + dx + LOS_RAY_RADIUS];
+        const struct ray_step *step = &ray_steps[r->first];
+        for (int i = 0; i < r->length; i++) {
+            int x = origin_x + step[i].dx;
+            int y = origin_y + step[i].dy;
+            if (is_opaque(lvl, x, y)) {
+                *blocker_x = x;
+                *blocker_y = y;
+                return true;
+            }
         }
+        return false;
+    }
 
-        if (! checker(lvl, cur_x, cur_y)) {
-            return false;
+    // Too long for the tables, step it out instead
+    struct line_walk w;
+    line_start(&w, origin_x, origin_y, dx, dy);
+    for (int i = 1; i < w.run; i++) {
+        line_next(&w);
+        if (is_opaque(lvl, w.x, w.y)) {
+            *blocker_x = w.x;
+            *blocker_y = w.y;
+            return true;
         }
     }
+    return false;
+}
+
+// Whether a line from origin to target is stopped by an opaque cell before
+// reaching the target, and if so where. The ends themselves never block.
+bool line_first_blocker(level *lvl, int origin_x, int origin_y, int target_x, int target_y, int *blocker_x, int *blocker_y) {
+    if (!rays_ready) build_rays();
+    return find_blocker(lvl, origin_x, origin_y, target_x, target_y, blocker_x, blocker_y);
+}
+
+struct los_cache* make_los_cache(void) {
+    // Levels are made on the main thread, so the shared tables get built
+    // before anything could walk them from a worker
+    if (!rays_ready) build_rays();
+
+    struct los_cache *cache = malloc(sizeof(struct los_cache));
+    if (cache == NULL) exit(1);
+    for (int i = 0; i < LOS_CACHE_SIZE; i++) cache->entries[i].version = -1;
+    cache->hits = 0;
+    cache->misses = 0;
+    return cache;
+}
+
+void destroy_los_cache(struct los_cache *cache) {
+    free((void*)cache);
 }
 
+static struct los_entry* cache_slot(struct los_cache *cache, int origin_x, int origin_y, int target_x, int target_y) {
+    unsigned int h = (unsigned int)origin_x * 73856093u
+        ^ (unsigned int)origin_y * 19349663u
+        ^ (unsigned int)target_x * 83492791u
+        ^ (unsigned int)target_y * 2654435761u;
+    return &cache->entries[h & (LOS_CACHE_SIZE - 1)];
+}
+
+// Whether terrain lets a line through from origin to target. Mobs don't
+// block sight. Answers come from the level's cache when no tile they
+// depend on has changed since, so this isn't safe to call from threads.
 bool line_of_sight(level *lvl, int origin_x, int origin_y, int target_x, int target_y) {
-    return check_line(lvl, origin_x, origin_y, target_x, target_y, &is_position_valid);
+    struct los_cache *cache = lvl->sight_cache;
+    struct los_entry *entry = cache_slot(cache, origin_x, origin_y, target_x, target_y);
+
+    if (entry->version >= 0
+            && entry->origin_x == origin_x && entry->origin_y == origin_y
+            && entry->target_x == target_x && entry->target_y == target_y) {
+        // The line never leaves the box spanned by its ends
+        int x0 = origin_x < target_x ? origin_x : target_x;
+        int x1 = origin_x < target_x ? target_x : origin_x;
+        int y0 = origin_y < target_y ? origin_y : target_y;
+        int y1 = origin_y < target_y ? target_y : origin_y;
+        if (entry->version == lvl->terrain_version || !terrain_changed_within(lvl, entry->version, x0, y0, x1, y1)) {
+            entry->version = lvl->terrain_version;
+            cache->hits++;
+            return entry->visible;
+        }
+    }
+
+    cache->misses++;
+    entry->origin_x = origin_x;
+    entry->origin_y = origin_y;
+    entry->target_x = target_x;
+    entry->target_y = target_y;
+    entry->version = lvl->terrain_version;
+    int blocker_x, blocker_y;
+    entry->visible = !find_blocker(lvl, origin_x, origin_y, target_x, target_y, &blocker_x, &blocker_y);
+    return entry->visible;
 }
 
 bool can_see(level *lvl, mobile *actor, int target_x, int target_y) {
     return line_of_sight(lvl, actor->x, actor->y, target_x, target_y);
 }
+
+// Whether the mob could see the player as of the last vision pass. The
+// player's field of view is symmetric, so this is the player seeing the
+// mob, and the mob also has to be within MOB_SIGHT_RADIUS.
+bool mob_sees_player(level *lvl, mobile *mob) {
+    int dx = mob->x - lvl->player->x;
+    int dy = mob->y - lvl->player->y;
+    if (dx*dx + dy*dy > MOB_SIGHT_RADIUS*MOB_SIGHT_RADIUS) return false;
+    return lvl->visible[mob->x][mob->y];
+}
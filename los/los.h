@@ -5,9 +5,37 @@
 #include "../level/level.h"
 #include "../log.h"
 
-typedef bool (*checker_func)(level *lvl, int x, int y);
+// Lines spanning at most this many tiles along each axis walk a
+// precomputed ray instead of stepping. The table grows with the cube of
+// this, and longer lines are rare enough to step.
+#define LOS_RAY_RADIUS 20
+
+// Slots in a level's line of sight cache, a power of two
+#define LOS_CACHE_SIZE 4096
+
+struct los_entry {
+    short origin_x, origin_y;
+    short target_x, target_y;
+    // Terrain version the result is known good for, -1 when empty
+    int version;
+    bool visible;
+};
+
+// Remembers recent line_of_sight() answers. An answer stays good until a
+// tile inside the box spanned by its two ends changes, so a door only
+// knocks out the lines that could pass through it.
+struct los_cache {
+    struct los_entry entries[LOS_CACHE_SIZE];
+    long hits;
+    long misses;
+};
+
+struct los_cache* make_los_cache(void);
+void destroy_los_cache(struct los_cache *cache);
 
 bool line_of_sight(level *lvl, int origin_x, int origin_y, int target_x, int target_y);
+bool line_first_blocker(level *lvl, int origin_x, int origin_y, int target_x, int target_y, int *blocker_x, int *blocker_y);
 bool can_see(level *lvl, mobile *actor, int target_x, int target_y);
+bool mob_sees_player(level *lvl, mobile *mob);
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef INC_VIEWER_FOV_H
+#define INC_VIEWER_FOV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// One viewer's field of view, a bit per tile over the box within radius
+// of where it was computed from, clipped to the map, as compute_fovs()
+// fills it in. Kept apart from fov.h so that whatever holds one needn't
+// pull in the rest.
+struct viewer_fov {
+    int x, y;
+    int radius;
+    int mode;
+    int x0, y0;
+    int width, height;
+    // Terrain version the bits are good for, -1 until first computed
+    int version;
+    bool stale;
+    uint64_t *bits;
+    int capacity; // words
+};
+
+void init_viewer_fov(struct viewer_fov *fov);
+void free_viewer_fov(struct viewer_fov *fov);
+
+static inline bool viewer_fov_sees(const struct viewer_fov *fov, int x, int y) {
+    int bx = x - fov->x0;
+    int by = y - fov->y0;
+    if (fov->version < 0 || bx < 0 || bx >= fov->width || by < 0 || by >= fov->height) return false;
+    int i = by * fov->width + bx;
+    return (fov->bits[i / 64] >> (i % 64)) & 1;
+}
+
+#endif
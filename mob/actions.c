@@ -24,8 +24,12 @@ void mob_toggle_door(level *lvl, mobile *mob, direction dir) {
     }
     if (lvl->tiles[x][y] == DOOR_OPEN) {
         lvl->tiles[x][y] = DOOR_CLOSED;
+        level_terrain_changed(lvl, x, y);
+        sensory_bus_publish(lvl->senses, lvl->sim, NOISE, x, y, DOOR_NOISE_RADIUS);
     } else if (lvl->tiles[x][y] == DOOR_CLOSED) {
         lvl->tiles[x][y] = DOOR_OPEN;
+        level_terrain_changed(lvl, x, y);
+        sensory_bus_publish(lvl->senses, lvl->sim, NOISE, x, y, DOOR_NOISE_RADIUS);
     }
 }
 
@@ -60,6 +64,7 @@ void mob_smash_potion(level *lvl, mobile *mob) {
     ((item*)mob)->contents = inv->next;
     free((void*)inv);
     destroy_item(potion);
+    sensory_bus_publish(lvl->senses, lvl->sim, NOISE, mob->x, mob->y, SMASH_NOISE_RADIUS);
 }
 
 void mob_rotate_inventory(mobile* mob) {
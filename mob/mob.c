@@ -12,7 +12,16 @@ mobile* make_mob(struct Level *lvl) {
     ((item*)mob)->display = ICON_UNDEFINED;
     ((item*)mob)->chemistry = make_constituents();
     ((item*)mob)->type = Creature;
-    mob->state = NULL;
+    mob->species = Goblin;
+    mob->co = (struct coroutine)COROUTINE_INIT;
+    mob->agent = NO_AGENT;
+    mob->place = -1;
+    mob->sees_player = false;
+    mob->vision_pass = 0;
+    int_vector_init(&mob->route);
+    mob->seed = 0;
+    mob->lod_steps = 1;
+    mob->alert = 0;
     for (int i = 0; i < SENSORY_EVENT_COUNT; i++) ((item*)mob)->listeners[i].handler = NULL;
     mob->lvl = lvl;
     mob->x = 0;
@@ -26,6 +35,7 @@ mobile* make_mob(struct Level *lvl) {
 }
 void destroy_mob(mobile *mob) {
     destroy_constituents(((item*)mob)->chemistry);
+    int_vector_free(&mob->route);
     inventory_item *inv = ((item*)mob)->contents;
     while (inv != NULL) {
         inventory_item *next = inv->next;
@@ -33,9 +43,6 @@ void destroy_mob(mobile *mob) {
         inv = next;
     }
     free((void*)((item*)mob)->name);
-    if (mob->state != NULL) {
-        free(mob->state);
-    }
     free((void*)mob);
 }
 
@@ -43,6 +50,7 @@ void push_inventory(mobile* mob, item* itm) {
     inventory_item *new_entry = malloc(sizeof(inventory_item));
     new_entry->next = NULL;
     new_entry->item = itm;
+    new_entry->place = -1;
 
     if (((item*)mob)->contents == NULL) {
         ((item*)mob)->contents = new_entry;
@@ -122,25 +130,70 @@ int random_walk_next_firing(void *context, void* vmob, struct event_listener *li
 
 void random_walk_fire(void *context, void* vmob) {
     mobile *mob = (mobile*)vmob;
-    int x = mob->x;
-    int y = mob->y;
 
-    if (prob(0.5)) {
-        x += rand_int(2) - 1;
-    } else {
-        y += rand_int(2) - 1;
+    for (int i = 0; i < mob->lod_steps; i++) {
+        int x = mob->x;
+        int y = mob->y;
+
+        if (prob(0.5)) {
+            x += rand_int(2) - 1;
+        } else {
+            y += rand_int(2) - 1;
+        }
+
+        if (x != mob->x || y != mob->y) {
+            if (!(move_if_valid(mob->lvl, mob, x, y))) {
+                mob->emote = EMOTE_ANGRY;
+            }
+        }
     }
+}
 
-    if (x != mob->x || y != mob->y) {
-        if (!(move_if_valid(mob->lvl, mob, x, y))) {
+void random_walk_plan(void *context, void* vmob, struct intent *intent) {
+    mobile *mob = (mobile*)vmob;
+
+    for (int i = 0; i < mob->lod_steps; i++) {
+        if (prob_r(0.5, &mob->seed)) {
+            intent->dx += rand_int_r(2, &mob->seed) - 1;
+        } else {
+            intent->dy += rand_int_r(2, &mob->seed) - 1;
+        }
+    }
+}
+
+void step_apply(void *context, void* vmob, struct intent *intent) {
+    mobile *mob = (mobile*)vmob;
+    int dx = intent->dx;
+    int dy = intent->dy;
+
+    // A far mob plans several steps at once, walk them a tile at a time
+    while (dx != 0 || dy != 0) {
+        int x_step = (dx > 0) - (dx < 0);
+        int y_step = x_step != 0 ? 0 : (dy > 0) - (dy < 0);
+        if (!(move_if_valid(mob->lvl, mob, mob->x + x_step, mob->y + y_step))) {
             mob->emote = EMOTE_ANGRY;
+            break;
         }
+        dx -= x_step;
+        dy -= y_step;
     }
 }
 
+// Listener handler resuming a mob's coroutine behaviour
+bool mob_wake(void *vmob) {
+    return coroutine_wake(&((mobile*)vmob)->co);
+}
+
 void item_deal_damage(level* lvl, item* itm, unsigned int amount) {
     itm->health -= amount;
+    if (itm->type == Creature) {
+        ((mobile*)itm)->alert = LOD_ALERT_FIRINGS;
+    }
     if (itm->listeners[DAMAGE].handler != NULL) {
         simulation_call_event_handler(lvl->sim  , &itm->listeners[DAMAGE]);
     }
+    // A hurt mob that was idling far away comes back to full rate now
+    if (itm->type == Creature && ((mobile*)itm)->lod_steps > 1) {
+        schedule_event(lvl->sim, ((mobile*)itm)->agent, lvl->sim->current_clock);
+    }
 }
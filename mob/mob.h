@@ -6,7 +6,7 @@
 
 #include "../config/game_cfg.h"
 #include "../simulation/simulation.h"
-#include "../simulation/vector.h"
+#include "../simulation/coroutine.h"
 #include "../chemistry/chemistry.h"
 
 enum item_type {Weapon, Potion, Creature};
@@ -18,7 +18,9 @@ enum monster_type {
     Orc,
     Umberhulk,
     Minotaur,
-    NUM_MONSTER_TYPES
+    NUM_MONSTER_TYPES,
+    // Never rolled for, but dispatched on like the others
+    Player = NUM_MONSTER_TYPES
 };
 
 struct InventoryItem;
@@ -38,6 +40,8 @@ typedef struct {
 typedef struct InventoryItem {
     item* item;
     struct InventoryItem* next;
+    // Entry in the level's item index while on the floor, -1 otherwise
+    int place;
 } inventory_item;
 
 typedef struct Mobile {
@@ -48,7 +52,24 @@ typedef struct Mobile {
     bool active;
     bool stacks;
     chtype emote;
-    void *state;
+    enum monster_type species;
+    // Where a coroutine behaviour left off, see simulation/coroutine.h
+    struct coroutine co;
+    agent_handle agent;
+    // Entry in the level's mob index, and so its subscription on the
+    // sensory bus, -1 for none
+    int place;
+    // Kept by level_update_vision(), with the pass that last looked
+    bool sees_player;
+    int vision_pass;
+    // Cells still to walk on the way somewhere, next one last, see
+    // find_path()
+    int_vector route;
+    // Steps taken per firing while far from the player, see lod_delay()
+    int lod_steps;
+    int alert;
+    // Private random stream for plan(), which can't share rand()
+    unsigned int seed;
 } mobile;
 
 mobile* make_mob();
@@ -66,4 +87,7 @@ int every_turn_firing(void *context, void* mob, struct event_listener *listeners
 void player_move_fire(void *context, void* vmob);
 int random_walk_next_firing(void *context, void* mob, struct event_listener *listeners);
 void random_walk_fire(void *context, void* mob);
+void random_walk_plan(void *context, void* mob, struct intent *intent);
+void step_apply(void *context, void* mob, struct intent *intent);
+bool mob_wake(void *mob);
 #endif
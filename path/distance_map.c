@@ -0,0 +1,229 @@
+#include <stdlib.h>
+
+#include "distance_map.h"
+
+static const int neighbours[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+
+static bool blocks_path(level *lvl, int x, int y) {
+    return lvl->tiles[x][y] == TILE_WALL || lvl->tiles[x][y] == DOOR_CLOSED;
+}
+
+static inline bool on_map(struct distance_map *map, int x, int y) {
+    return 0 <= x && x < map->width && 0 <= y && y < map->height;
+}
+
+struct distance_map* make_distance_map(level *lvl, int max_distance) {
+    struct distance_map *map = malloc(sizeof(struct distance_map));
+    if (map == NULL) exit(1);
+    map->width = lvl->width;
+    map->height = lvl->height;
+    map->max_distance = max_distance;
+
+    map->dist = malloc(map->width * sizeof(int*));
+    map->dist[0] = malloc(map->width * map->height * sizeof(int));
+    map->goal = malloc(map->width * sizeof(bool*));
+    map->goal[0] = malloc(map->width * map->height * sizeof(bool));
+    if (map->dist[0] == NULL || map->goal[0] == NULL) exit(1);
+    for (int x = 1; x < map->width; x++) {
+        map->dist[x] = map->dist[0] + x * map->height;
+        map->goal[x] = map->goal[0] + x * map->height;
+    }
+    for (int x = 0; x < map->width; x++) {
+        for (int y = 0; y < map->height; y++) {
+            map->dist[x][y] = DISTANCE_UNREACHED;
+            map->goal[x][y] = false;
+        }
+    }
+
+    map->check = malloc((max_distance + 1) * sizeof(int_vector));
+    map->relax = malloc((max_distance + 1) * sizeof(int_vector));
+    if (map->check == NULL || map->relax == NULL) exit(1);
+    for (int d = 0; d <= max_distance; d++) {
+        int_vector_init(&map->check[d]);
+        int_vector_init(&map->relax[d]);
+    }
+    int_vector_init(&map->invalid);
+    return map;
+}
+
+void destroy_distance_map(struct distance_map *map) {
+    for (int d = 0; d <= map->max_distance; d++) {
+        int_vector_free(&map->check[d]);
+        int_vector_free(&map->relax[d]);
+    }
+    free((void*)map->check);
+    free((void*)map->relax);
+    int_vector_free(&map->invalid);
+    free((void*)map->dist[0]);
+    free((void*)map->dist);
+    free((void*)map->goal[0]);
+    free((void*)map->goal);
+    free((void*)map);
+}
+
+// Queue a cell whose distance may no longer be backed by a path
+static void push_check(struct distance_map *map, int x, int y) {
+    int d = map->dist[x][y];
+    if (d != DISTANCE_UNREACHED) int_vector_push(&map->check[d], x * map->height + y);
+}
+
+// Best distance a cell could have from its neighbours as they stand
+static int tentative(struct distance_map *map, level *lvl, int x, int y) {
+    if (blocks_path(lvl, x, y)) return DISTANCE_UNREACHED;
+    if (map->goal[x][y]) return 0;
+
+    int best = DISTANCE_UNREACHED;
+    for (int i = 0; i < 4; i++) {
+        int nx = x + neighbours[i][0];
+        int ny = y + neighbours[i][1];
+        if (on_map(map, nx, ny) && map->dist[nx][ny] < best) best = map->dist[nx][ny];
+    }
+    if (best == DISTANCE_UNREACHED || best + 1 > map->max_distance) return DISTANCE_UNREACHED;
+    return best + 1;
+}
+
+static void push_relax(struct distance_map *map, level *lvl, int x, int y) {
+    int d = tentative(map, lvl, x, y);
+    if (d < map->dist[x][y]) {
+        map->dist[x][y] = d;
+        int_vector_push(&map->relax[d], x * map->height + y);
+    }
+}
+
+// Spread distances outwards from the cells pushed with push_relax(),
+// breadth first
+static void spread(struct distance_map *map, level *lvl) {
+    for (int d = 0; d <= map->max_distance; d++) {
+        int_vector *bucket = &map->relax[d];
+        for (int i = 0; i < bucket->length; i++) {
+            int x = bucket->e[i] / map->height;
+            int y = bucket->e[i] % map->height;
+            if (map->dist[x][y] != d || d == map->max_distance) continue;
+            for (int n = 0; n < 4; n++) {
+                int nx = x + neighbours[n][0];
+                int ny = y + neighbours[n][1];
+                if (on_map(map, nx, ny) && d + 1 < map->dist[nx][ny] && !blocks_path(lvl, nx, ny)) {
+                    map->dist[nx][ny] = d + 1;
+                    int_vector_push(&map->relax[d + 1], nx * map->height + ny);
+                }
+            }
+        }
+        int_vector_clear(bucket);
+    }
+}
+
+// Bring the map back in line after a goal was added or terrain changed.
+// Cells queued with push_check() are looked at in order of distance, and
+// any that no longer have a neighbour one step closer lose their distance,
+// which in turn puts the cells that counted on them up for checking. Then
+// the cells that lost their distance, and any cell pushed with
+// push_relax(), spread distances outwards again.
+static void repair(struct distance_map *map, level *lvl) {
+    int_vector_clear(&map->invalid);
+    for (int d = 0; d <= map->max_distance; d++) {
+        int_vector *bucket = &map->check[d];
+        for (int i = 0; i < bucket->length; i++) {
+            int x = bucket->e[i] / map->height;
+            int y = bucket->e[i] % map->height;
+            if (map->dist[x][y] != d) continue;
+
+            bool supported = false;
+            if (!blocks_path(lvl, x, y)) {
+                if (map->goal[x][y]) {
+                    supported = d == 0;
+                } else {
+                    for (int n = 0; n < 4 && !supported; n++) {
+                        int nx = x + neighbours[n][0];
+                        int ny = y + neighbours[n][1];
+                        supported = on_map(map, nx, ny) && map->dist[nx][ny] == d - 1;
+                    }
+                }
+            }
+            if (supported) continue;
+
+            map->dist[x][y] = DISTANCE_UNREACHED;
+            int_vector_push(&map->invalid, bucket->e[i]);
+            if (d == map->max_distance) continue;
+            for (int n = 0; n < 4; n++) {
+                int nx = x + neighbours[n][0];
+                int ny = y + neighbours[n][1];
+                if (on_map(map, nx, ny) && map->dist[nx][ny] == d + 1) {
+                    int_vector_push(&map->check[d + 1], nx * map->height + ny);
+                }
+            }
+        }
+        int_vector_clear(bucket);
+    }
+
+    for (int i = 0; i < map->invalid.length; i++) {
+        push_relax(map, lvl, map->invalid.e[i] / map->height, map->invalid.e[i] % map->height);
+    }
+    spread(map, lvl);
+}
+
+// Work the whole map out again from the goals. When a goal moves nearly
+// every cell it reaches changes distance, and the repair above would visit
+// each of them twice to a flood's once.
+static void rebuild(struct distance_map *map, level *lvl) {
+    for (int x = 0; x < map->width; x++) {
+        for (int y = 0; y < map->height; y++) {
+            map->dist[x][y] = DISTANCE_UNREACHED;
+        }
+    }
+    for (int x = 0; x < map->width; x++) {
+        for (int y = 0; y < map->height; y++) {
+            if (map->goal[x][y]) push_relax(map, lvl, x, y);
+        }
+    }
+    spread(map, lvl);
+}
+
+void distance_map_add_goal(struct distance_map *map, level *lvl, int x, int y) {
+    map->goal[x][y] = true;
+    push_relax(map, lvl, x, y);
+    repair(map, lvl);
+}
+
+void distance_map_remove_goal(struct distance_map *map, level *lvl, int x, int y) {
+    map->goal[x][y] = false;
+    rebuild(map, lvl);
+}
+
+// Same as removing one goal and adding the other, in a single rebuild
+void distance_map_move_goal(struct distance_map *map, level *lvl, int from_x, int from_y, int to_x, int to_y) {
+    if (from_x == to_x && from_y == to_y) return;
+    map->goal[from_x][from_y] = false;
+    map->goal[to_x][to_y] = true;
+    rebuild(map, lvl);
+}
+
+// The tile at (x, y) started or stopped blocking the way
+void distance_map_terrain_changed(struct distance_map *map, level *lvl, int x, int y) {
+    if (blocks_path(lvl, x, y)) {
+        push_check(map, x, y);
+    } else {
+        push_relax(map, lvl, x, y);
+    }
+    repair(map, lvl);
+}
+
+// Move (x, y) one step downhill, onto the closest free neighbour. Returns
+// false when no free neighbour is closer to a goal than where it stands.
+bool distance_map_step(struct distance_map *map, level *lvl, int *x, int *y) {
+    int best = map->dist[*x][*y];
+    int best_x = *x;
+    int best_y = *y;
+    for (int n = 0; n < 4; n++) {
+        int nx = *x + neighbours[n][0];
+        int ny = *y + neighbours[n][1];
+        if (on_map(map, nx, ny) && map->dist[nx][ny] < best && is_position_valid(lvl, nx, ny)) {
+            best = map->dist[nx][ny];
+            best_x = nx;
+            best_y = ny;
+        }
+    }
+    if (best_x == *x && best_y == *y) return false;
+    *x = best_x;
+    *y = best_y;
+    return true;
+}
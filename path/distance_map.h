@@ -0,0 +1,46 @@
+#ifndef INC_DISTANCE_MAP_H
+#define INC_DISTANCE_MAP_H
+
+#include <limits.h>
+#include <stdbool.h>
+
+#include "../level/level.h"
+#include "../simulation/containers.h"
+
+// Cells further than max_distance steps from every goal, or walled off
+#define DISTANCE_UNREACHED INT_MAX
+
+// Steps from each cell to the nearest goal, moving between orthogonal
+// neighbours through anything but walls and closed doors, so any number
+// of hunters can share it and walk downhill. A door toggling or a goal
+// being added is repaired in place, touching the cells behind the change.
+// A goal moving or going away changes the distance of about every cell it
+// reaches, so the map is flooded afresh from the goals instead.
+struct distance_map {
+    int width;
+    int height;
+    int max_distance;
+    int **dist;
+    bool **goal;
+    // Scratch for repairs, cells packed as x * height + y and bucketed by
+    // distance
+    int_vector *check;
+    int_vector *relax;
+    int_vector invalid;
+};
+
+struct distance_map* make_distance_map(level *lvl, int max_distance);
+void destroy_distance_map(struct distance_map *map);
+
+void distance_map_add_goal(struct distance_map *map, level *lvl, int x, int y);
+void distance_map_remove_goal(struct distance_map *map, level *lvl, int x, int y);
+void distance_map_move_goal(struct distance_map *map, level *lvl, int from_x, int from_y, int to_x, int to_y);
+void distance_map_terrain_changed(struct distance_map *map, level *lvl, int x, int y);
+
+bool distance_map_step(struct distance_map *map, level *lvl, int *x, int *y);
+
+static inline int distance_to_goal(struct distance_map *map, int x, int y) {
+    return map->dist[x][y];
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+
+#include "regions.h"
+
+static int find(struct regions *regions, int room) {
+    while (regions->parent[room] != room) room = regions->parent[room];
+    return room;
+}
+
+static void join(struct regions *regions, int a, int b) {
+    a = find(regions, a);
+    b = find(regions, b);
+    if (a == b) return;
+    if (regions->size[a] < regions->size[b]) {
+        int swap = a;
+        a = b;
+        b = swap;
+    }
+    regions->parent[b] = a;
+    regions->size[a] += regions->size[b];
+
+    // Splice the two circles of rooms into one
+    int next = regions->next[a];
+    regions->next[a] = regions->next[b];
+    regions->next[b] = next;
+}
+
+// Start over with every room on its own and join them back up through the
+// doors that are open
+static void rebuild(struct regions *regions, level *lvl) {
+    struct room_graph *graph = regions->graph;
+    for (int r = 0; r < graph->room_count; r++) {
+        regions->parent[r] = r;
+        regions->size[r] = 1;
+        regions->next[r] = r;
+    }
+    for (int d = 0; d < graph->doors.length; d++) {
+        struct door *door = &graph->doors.e[d];
+        if (lvl->tiles[door->x][door->y] == DOOR_OPEN) join(regions, door->rooms[0], door->rooms[1]);
+    }
+}
+
+struct regions* make_regions(struct room_graph *graph, level *lvl) {
+    struct regions *regions = malloc(sizeof(struct regions));
+    if (regions == NULL) exit(1);
+    regions->graph = graph;
+
+    int rooms = graph->room_count > 0 ? graph->room_count : 1;
+    regions->parent = malloc(rooms * sizeof(int));
+    regions->size = malloc(rooms * sizeof(int));
+    regions->next = malloc(rooms * sizeof(int));
+    regions->floors = malloc(rooms * sizeof(int_vector));
+    if (regions->parent == NULL || regions->size == NULL || regions->next == NULL || regions->floors == NULL) exit(1);
+
+    for (int r = 0; r < graph->room_count; r++) int_vector_init(&regions->floors[r]);
+    for (int x = 0; x < graph->width; x++) {
+        for (int y = 0; y < graph->height; y++) {
+            if (graph->room[x][y] != NO_ROOM) int_vector_push(&regions->floors[graph->room[x][y]], x * graph->height + y);
+        }
+    }
+
+    rebuild(regions, lvl);
+    return regions;
+}
+
+void destroy_regions(struct regions *regions) {
+    for (int r = 0; r < regions->graph->room_count; r++) int_vector_free(&regions->floors[r]);
+    free((void*)regions->floors);
+    free((void*)regions->parent);
+    free((void*)regions->size);
+    free((void*)regions->next);
+    free((void*)regions);
+}
+
+// The tile at (x, y) changed. Only doors matter: one opening joins its
+// two regions, one closing may split a region, so they're worked out again.
+void regions_door_toggled(struct regions *regions, level *lvl, int x, int y) {
+    int d = regions->graph->door[x][y];
+    if (d == NO_DOOR) return;
+    struct door *door = &regions->graph->doors.e[d];
+    if (lvl->tiles[x][y] == DOOR_OPEN) {
+        join(regions, door->rooms[0], door->rooms[1]);
+    } else {
+        rebuild(regions, lvl);
+    }
+}
+
+// The region of the tile at (x, y), or NO_REGION for walls and closed doors
+int region_at(struct regions *regions, level *lvl, int x, int y) {
+    struct room_graph *graph = regions->graph;
+    if (graph->room[x][y] != NO_ROOM) return find(regions, graph->room[x][y]);
+    int d = graph->door[x][y];
+    if (d != NO_DOOR && lvl->tiles[x][y] == DOOR_OPEN) return find(regions, graph->doors.e[d].rooms[0]);
+    return NO_REGION;
+}
+
+// Whether one could walk between the two tiles without opening a door
+bool same_region(struct regions *regions, level *lvl, int x0, int y0, int x1, int y1) {
+    int region = region_at(regions, lvl, x0, y0);
+    return region != NO_REGION && region == region_at(regions, lvl, x1, y1);
+}
+
+// Push every tile of a region onto cells, packed as x * height + y: the
+// floors of its rooms and the open doors between them
+void region_cells(struct regions *regions, level *lvl, int region, int_vector *cells) {
+    struct room_graph *graph = regions->graph;
+    int r = region;
+    do {
+        int_vector *floor = &regions->floors[r];
+        for (int i = 0; i < floor->length; i++) int_vector_push(cells, floor->e[i]);
+
+        int_vector *doors = &graph->rooms[r].doors;
+        for (int i = 0; i < doors->length; i++) {
+            struct door *door = &graph->doors.e[doors->e[i]];
+            if (door->rooms[0] == r && lvl->tiles[door->x][door->y] == DOOR_OPEN) {
+                int_vector_push(cells, door->x * graph->height + door->y);
+            }
+        }
+        r = regions->next[r];
+    } while (r != region);
+}
@@ -0,0 +1,39 @@
+#ifndef INC_REGIONS_H
+#define INC_REGIONS_H
+
+#include <stdbool.h>
+
+#include "../level/level.h"
+#include "../simulation/containers.h"
+#include "room_graph.h"
+
+// For walls and closed doors, which are in no region
+#define NO_REGION -1
+
+// Which of the room graph's rooms are joined up through open doors. The
+// rooms are kept in a union-find, merged as doors open and rebuilt from
+// the open doors when one closes, which only ever looks at rooms and
+// doors, never the tiles. A region is named by one of its rooms.
+//
+// Queries don't compress paths, so they're safe alongside each other;
+// union by size keeps the trees shallow instead.
+struct regions {
+    struct room_graph *graph;
+    int *parent;
+    int *size;
+    // Each room's next room in the same region, round in a circle
+    int *next;
+    // Each room's floor, as packed cells
+    int_vector *floors;
+};
+
+struct regions* make_regions(struct room_graph *graph, level *lvl);
+void destroy_regions(struct regions *regions);
+
+void regions_door_toggled(struct regions *regions, level *lvl, int x, int y);
+
+int region_at(struct regions *regions, level *lvl, int x, int y);
+bool same_region(struct regions *regions, level *lvl, int x0, int y0, int x1, int y1);
+void region_cells(struct regions *regions, level *lvl, int region, int_vector *cells);
+
+#endif
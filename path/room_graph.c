@@ -0,0 +1,361 @@
+#include <limits.h>
+#include <stdlib.h>
+
+#include "room_graph.h"
+
+static const int neighbours[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+
+static bool blocks_path(level *lvl, int x, int y) {
+    return lvl->tiles[x][y] == TILE_WALL || lvl->tiles[x][y] == DOOR_CLOSED;
+}
+
+static inline bool on_map(struct room_graph *graph, int x, int y) {
+    return 0 <= x && x < graph->width && 0 <= y && y < graph->height;
+}
+
+static inline int manhattan(int x0, int y0, int x1, int y1) {
+    return abs(x1 - x0) + abs(y1 - y0);
+}
+
+// Order for the cell search, by estimated length and then furthest along,
+// which on open floor heads straight for the end instead of filling in
+// every cell with the same estimate
+static inline int cell_rank(int cost, int estimate) {
+    return ((cost + estimate) << 16) - cost;
+}
+
+static int** make_grid(int width, int height) {
+    int **grid = malloc(width * sizeof(int*));
+    if (grid == NULL) exit(1);
+    grid[0] = malloc(width * height * sizeof(int));
+    if (grid[0] == NULL) exit(1);
+    for (int x = 1; x < width; x++) {
+        grid[x] = grid[0] + x * height;
+    }
+    return grid;
+}
+
+static void free_grid(int **grid) {
+    free((void*)grid[0]);
+    free((void*)grid);
+}
+
+// Join the rooms either side of the door at (x, y)
+static void add_door(struct room_graph *graph, int x, int y) {
+    int a, b;
+    if (0 < x && x + 1 < graph->width && graph->room[x-1][y] != NO_ROOM && graph->room[x+1][y] != NO_ROOM) {
+        a = graph->room[x-1][y];
+        b = graph->room[x+1][y];
+    } else if (0 < y && y + 1 < graph->height && graph->room[x][y-1] != NO_ROOM && graph->room[x][y+1] != NO_ROOM) {
+        a = graph->room[x][y-1];
+        b = graph->room[x][y+1];
+    } else {
+        return;
+    }
+    if (a == b) return;
+
+    struct door door;
+    door.x = x;
+    door.y = y;
+    door.rooms[0] = a;
+    door.rooms[1] = b;
+    door.slots[0] = graph->rooms[a].doors.length;
+    door.slots[1] = graph->rooms[b].doors.length;
+
+    graph->door[x][y] = graph->doors.length;
+    int_vector_push(&graph->rooms[a].doors, graph->doors.length);
+    int_vector_push(&graph->rooms[b].doors, graph->doors.length);
+    door_vector_push(&graph->doors, door);
+}
+
+// room_tiles holds the room, from 1 to room_count, that each cell was
+// partitioned into. Floor cells belong to their room and doors join the
+// rooms on either side.
+struct room_graph* make_room_graph(level *lvl, int **room_tiles, int room_count) {
+    struct room_graph *graph = malloc(sizeof(struct room_graph));
+    if (graph == NULL) exit(1);
+    graph->width = lvl->width;
+    graph->height = lvl->height;
+    graph->room = make_grid(graph->width, graph->height);
+    graph->door = make_grid(graph->width, graph->height);
+    graph->room_count = room_count;
+    graph->rooms = malloc(room_count * sizeof(struct room));
+    if (graph->rooms == NULL) exit(1);
+    door_vector_init(&graph->doors);
+
+    for (int r = 0; r < room_count; r++) {
+        struct room *room = &graph->rooms[r];
+        room->x0 = graph->width;
+        room->y0 = graph->height;
+        room->x1 = -1;
+        room->y1 = -1;
+        int_vector_init(&room->doors);
+        room->version = lvl->terrain_version;
+    }
+
+    for (int x = 0; x < graph->width; x++) {
+        for (int y = 0; y < graph->height; y++) {
+            graph->room[x][y] = NO_ROOM;
+            graph->door[x][y] = NO_DOOR;
+            if (lvl->tiles[x][y] != TILE_FLOOR) continue;
+
+            int r = room_tiles[x][y] - 1;
+            struct room *room = &graph->rooms[r];
+            graph->room[x][y] = r;
+            if (x < room->x0) room->x0 = x;
+            if (y < room->y0) room->y0 = y;
+            if (x > room->x1) room->x1 = x;
+            if (y > room->y1) room->y1 = y;
+        }
+    }
+
+    for (int x = 0; x < graph->width; x++) {
+        for (int y = 0; y < graph->height; y++) {
+            if (lvl->tiles[x][y] == DOOR_CLOSED || lvl->tiles[x][y] == DOOR_OPEN) add_door(graph, x, y);
+        }
+    }
+
+    for (int r = 0; r < room_count; r++) {
+        struct room *room = &graph->rooms[r];
+        int routes = room->doors.length * room->doors.length;
+        room->lengths = malloc(routes * sizeof(int));
+        room->routes = malloc(routes * sizeof(int_vector));
+        if (routes > 0 && (room->lengths == NULL || room->routes == NULL)) exit(1);
+        for (int i = 0; i < routes; i++) {
+            room->lengths[i] = ROUTE_UNKNOWN;
+            int_vector_init(&room->routes[i]);
+        }
+    }
+
+    int door_count = graph->doors.length > 0 ? graph->doors.length : 1;
+    graph->cost = malloc(door_count * sizeof(int));
+    graph->parent = malloc(door_count * sizeof(int));
+    graph->via = malloc(door_count * sizeof(int));
+    if (graph->cost == NULL || graph->parent == NULL || graph->via == NULL) exit(1);
+    open_heap_init(&graph->door_open);
+
+    graph->cell_cost = make_grid(graph->width, graph->height);
+    graph->cell_parent = make_grid(graph->width, graph->height);
+    graph->seen = make_grid(graph->width, graph->height);
+    for (int x = 0; x < graph->width; x++) {
+        for (int y = 0; y < graph->height; y++) {
+            graph->seen[x][y] = 0;
+        }
+    }
+    graph->stamp = 0;
+    open_heap_init(&graph->cell_open);
+    return graph;
+}
+
+void destroy_room_graph(struct room_graph *graph) {
+    for (int r = 0; r < graph->room_count; r++) {
+        struct room *room = &graph->rooms[r];
+        int routes = room->doors.length * room->doors.length;
+        for (int i = 0; i < routes; i++) int_vector_free(&room->routes[i]);
+        free((void*)room->routes);
+        free((void*)room->lengths);
+        int_vector_free(&room->doors);
+    }
+    free((void*)graph->rooms);
+    door_vector_free(&graph->doors);
+    free_grid(graph->room);
+    free_grid(graph->door);
+    free((void*)graph->cost);
+    free((void*)graph->parent);
+    free((void*)graph->via);
+    open_heap_free(&graph->door_open);
+    free_grid(graph->cell_cost);
+    free_grid(graph->cell_parent);
+    free_grid(graph->seen);
+    open_heap_free(&graph->cell_open);
+    free((void*)graph);
+}
+
+// A* from (x0, y0) to (x1, y1) over the free floor of room r. The end
+// itself may be anything, so searches can run to the room's doors. Returns
+// the number of steps, or ROUTE_NONE. With out, also pushes the cells on
+// the way there as find_path() does.
+static int room_search(struct room_graph *graph, level *lvl, int r, int x0, int y0, int x1, int y1, int_vector *out) {
+    if (x0 == x1 && y0 == y1) return 0;
+
+    int start = x0 * graph->height + y0;
+    int end = x1 * graph->height + y1;
+    graph->stamp++;
+    graph->seen[x0][y0] = graph->stamp;
+    graph->cell_cost[x0][y0] = 0;
+    graph->cell_open.length = 0;
+    open_heap_push(&graph->cell_open, (struct open_node){ .f = cell_rank(0, manhattan(x0, y0, x1, y1)), .node = start });
+
+    bool found = false;
+    while (graph->cell_open.length > 0) {
+        struct open_node top = open_heap_pop(&graph->cell_open);
+        int x = top.node / graph->height;
+        int y = top.node % graph->height;
+        int cost = graph->cell_cost[x][y];
+        if (top.f > cell_rank(cost, manhattan(x, y, x1, y1))) continue;
+        if (top.node == end) {
+            found = true;
+            break;
+        }
+
+        for (int n = 0; n < 4; n++) {
+            int nx = x + neighbours[n][0];
+            int ny = y + neighbours[n][1];
+            if (!on_map(graph, nx, ny)) continue;
+            if (!(nx == x1 && ny == y1) && (graph->room[nx][ny] != r || blocks_path(lvl, nx, ny))) continue;
+            if (graph->seen[nx][ny] == graph->stamp && graph->cell_cost[nx][ny] <= cost + 1) continue;
+
+            graph->seen[nx][ny] = graph->stamp;
+            graph->cell_cost[nx][ny] = cost + 1;
+            graph->cell_parent[nx][ny] = top.node;
+            open_heap_push(&graph->cell_open, (struct open_node){ .f = cell_rank(cost + 1, manhattan(nx, ny, x1, y1)), .node = nx * graph->height + ny });
+        }
+    }
+    if (!found) return ROUTE_NONE;
+
+    if (out != NULL) {
+        for (int cell = end; cell != start; cell = graph->cell_parent[cell / graph->height][cell % graph->height]) {
+            int_vector_push(out, cell);
+        }
+    }
+    return graph->cell_cost[x1][y1];
+}
+
+static int door_slot(struct door *door, int r) {
+    return door->rooms[0] == r ? door->slots[0] : door->slots[1];
+}
+
+// Length of the route across room r between two of its doors, given by
+// their place in the room's list, searching for it the first time
+static int room_route(struct room_graph *graph, level *lvl, int r, int from, int to) {
+    struct room *room = &graph->rooms[r];
+    int count = room->doors.length;
+    if (terrain_changed_within(lvl, room->version, room->x0, room->y0, room->x1, room->y1)) {
+        for (int i = 0; i < count * count; i++) {
+            room->lengths[i] = ROUTE_UNKNOWN;
+            int_vector_clear(&room->routes[i]);
+        }
+    }
+    // Edits elsewhere leave the routes good, so they're good as of now too.
+    // Otherwise enough of those would push version out of the edit log.
+    room->version = lvl->terrain_version;
+
+    int i = from * count + to;
+    if (room->lengths[i] == ROUTE_UNKNOWN) {
+        struct door *a = &graph->doors.e[room->doors.e[from]];
+        struct door *b = &graph->doors.e[room->doors.e[to]];
+        room->lengths[i] = room_search(graph, lvl, r, a->x, a->y, b->x, b->y, &room->routes[i]);
+    }
+    return room->lengths[i];
+}
+
+static void open_door(struct room_graph *graph, int d, int cost, int parent, int via, int to_x, int to_y) {
+    struct door *door = &graph->doors.e[d];
+    graph->cost[d] = cost;
+    graph->parent[d] = parent;
+    graph->via[d] = via;
+    open_heap_push(&graph->door_open, (struct open_node){ .f = cost + manhattan(door->x, door->y, to_x, to_y), .node = d });
+}
+
+// Find a shortest path between two free cells, moving between orthogonal
+// neighbours, and fill path with the cells after (from_x, from_y) up to
+// and including (to_x, to_y). Cells are packed as x * height + y and
+// stored last first, so that walking the path pops them off the end.
+// Returns false, leaving path empty, when there is no way through.
+bool find_path(struct room_graph *graph, level *lvl, int from_x, int from_y, int to_x, int to_y, int_vector *path) {
+    int_vector_clear(path);
+    if (!on_map(graph, from_x, from_y) || !on_map(graph, to_x, to_y)) return false;
+    if (blocks_path(lvl, from_x, from_y) || blocks_path(lvl, to_x, to_y)) return false;
+    if (from_x == to_x && from_y == to_y) return true;
+
+    int from_room = graph->room[from_x][from_y];
+    int from_door = graph->door[from_x][from_y];
+    int to_room = graph->room[to_x][to_y];
+    int to_door = graph->door[to_x][to_y];
+    if ((from_room == NO_ROOM && from_door == NO_DOOR) || (to_room == NO_ROOM && to_door == NO_DOOR)) return false;
+
+    // The best way found so far, the last door it goes through and the
+    // room it crosses from there, or NO_DOOR for straight across one room
+    int best = INT_MAX;
+    int last_door = NO_DOOR;
+    int last_room = NO_ROOM;
+    if (from_room != NO_ROOM && from_room == to_room) {
+        int length = room_search(graph, lvl, from_room, from_x, from_y, to_x, to_y, NULL);
+        if (length != ROUTE_NONE) best = length;
+    }
+
+    for (int d = 0; d < graph->doors.length; d++) graph->cost[d] = INT_MAX;
+    graph->door_open.length = 0;
+    if (from_door != NO_DOOR) {
+        open_door(graph, from_door, 0, NO_DOOR, NO_ROOM, to_x, to_y);
+    } else {
+        int_vector *doors = &graph->rooms[from_room].doors;
+        for (int i = 0; i < doors->length; i++) {
+            struct door *door = &graph->doors.e[doors->e[i]];
+            if (blocks_path(lvl, door->x, door->y)) continue;
+            int length = room_search(graph, lvl, from_room, from_x, from_y, door->x, door->y, NULL);
+            if (length != ROUTE_NONE) open_door(graph, doors->e[i], length, NO_DOOR, from_room, to_x, to_y);
+        }
+    }
+
+    while (graph->door_open.length > 0) {
+        struct open_node top = open_heap_pop(&graph->door_open);
+        int d = top.node;
+        struct door *door = &graph->doors.e[d];
+        int cost = graph->cost[d];
+        if (top.f > cost + manhattan(door->x, door->y, to_x, to_y)) continue;
+        if (top.f >= best) break;
+        if (d == to_door) {
+            best = cost;
+            last_door = d;
+            break;
+        }
+
+        for (int side = 0; side < 2; side++) {
+            int r = door->rooms[side];
+            if (r == to_room) {
+                int length = room_search(graph, lvl, r, door->x, door->y, to_x, to_y, NULL);
+                if (length != ROUTE_NONE && cost + length < best) {
+                    best = cost + length;
+                    last_door = d;
+                    last_room = r;
+                }
+            }
+
+            int_vector *doors = &graph->rooms[r].doors;
+            for (int slot = 0; slot < doors->length; slot++) {
+                int next = doors->e[slot];
+                if (next == d || blocks_path(lvl, graph->doors.e[next].x, graph->doors.e[next].y)) continue;
+                int length = room_route(graph, lvl, r, door->slots[side], slot);
+                if (length == ROUTE_NONE || cost + length >= graph->cost[next]) continue;
+                open_door(graph, next, cost + length, d, r, to_x, to_y);
+            }
+        }
+    }
+    if (best == INT_MAX) return false;
+
+    // Lay the path down from the far end back, room by room
+    if (last_door == NO_DOOR) {
+        room_search(graph, lvl, from_room, from_x, from_y, to_x, to_y, path);
+        return true;
+    }
+    if (last_door != to_door) {
+        struct door *door = &graph->doors.e[last_door];
+        room_search(graph, lvl, last_room, door->x, door->y, to_x, to_y, path);
+    }
+    int d = last_door;
+    while (graph->parent[d] != NO_DOOR) {
+        int r = graph->via[d];
+        struct room *room = &graph->rooms[r];
+        int from = door_slot(&graph->doors.e[graph->parent[d]], r);
+        int to = door_slot(&graph->doors.e[d], r);
+        int_vector *route = &room->routes[from * room->doors.length + to];
+        for (int i = 0; i < route->length; i++) int_vector_push(path, route->e[i]);
+        d = graph->parent[d];
+    }
+    if (d != from_door) {
+        struct door *door = &graph->doors.e[d];
+        room_search(graph, lvl, from_room, from_x, from_y, door->x, door->y, path);
+    }
+    return true;
+}
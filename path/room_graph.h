@@ -0,0 +1,85 @@
+#ifndef INC_ROOM_GRAPH_H
+#define INC_ROOM_GRAPH_H
+
+#include <stdbool.h>
+
+#include "../level/level.h"
+#include "../simulation/containers.h"
+
+// In the room and door grids, for cells that are neither
+#define NO_ROOM -1
+#define NO_DOOR -1
+
+// Route lengths a room hasn't worked out yet, or found there is no route
+#define ROUTE_UNKNOWN -2
+#define ROUTE_NONE -1
+
+struct door {
+    int x;
+    int y;
+    // The rooms either side, and the door's place in each room's list
+    int rooms[2];
+    int slots[2];
+};
+
+VECTOR_DEFINE(door_vector, struct door)
+
+struct room {
+    // Bounds of the room's floor
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+    // Indices into the graph's doors
+    int_vector doors;
+    // Routes between every ordered pair of the room's doors, as in
+    // find_path(), looked up at [from * door count + to]. They're worked out
+    // on first use and thrown away when the floor changes after version.
+    int version;
+    int *lengths;
+    int_vector *routes;
+};
+
+// Search frontier entries, a door or a packed cell ordered by f
+struct open_node {
+    int f;
+    int node;
+};
+
+HEAP_DEFINE(open_heap, struct open_node, f)
+
+// The rooms make_map() partitions the level into, joined by its doors.
+// Paths are found room by room first, over the doors, and only then cell
+// by cell through each room on the way, with the routes between a room's
+// doors kept for the next search to cross it. Closed doors count as shut
+// and are read at search time, so toggling one needs no upkeep.
+//
+// Searches share scratch space, so only one may run at a time.
+struct room_graph {
+    int width;
+    int height;
+    int **room;
+    int **door;
+    int room_count;
+    struct room *rooms;
+    door_vector doors;
+
+    // Scratch for the door search, indexed by door
+    int *cost;
+    int *parent;
+    int *via;
+    open_heap door_open;
+    // Scratch for searches within a room, live where seen == stamp
+    int **cell_cost;
+    int **cell_parent;
+    int **seen;
+    int stamp;
+    open_heap cell_open;
+};
+
+struct room_graph* make_room_graph(level *lvl, int **room_tiles, int room_count);
+void destroy_room_graph(struct room_graph *graph);
+
+bool find_path(struct room_graph *graph, level *lvl, int from_x, int from_y, int to_x, int to_y, int_vector *path);
+
+#endif
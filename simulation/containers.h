@@ -0,0 +1,126 @@
+#ifndef CONTAINERS_H
+#define CONTAINERS_H
+
+#include <stdlib.h>
+
+// Typed containers, generated once per element type so that element
+// access is a plain load or store the compiler can see through. Both kinds
+// are structs meant to be embedded by value, start them with name_init()
+// and give the storage back with name_free(). Storage doubles when it runs
+// out and never shrinks.
+
+// Grow storage to hold at least needed elements, the slow path of a push
+static inline void container_grow(void **e, int *capacity, int needed, size_t element_size) {
+    int grown = *capacity == 0 ? 16 : *capacity * 2;
+    if (grown < needed) grown = needed;
+    *e = realloc(*e, grown * element_size);
+    if (*e == NULL) exit(1);
+    *capacity = grown;
+}
+
+// A growable array of T called name, with name_push(), name_pop(),
+// name_at() and friends
+#define VECTOR_DEFINE(name, T) \
+    typedef struct { \
+        T *e; \
+        int length; \
+        int capacity; \
+    } name; \
+    \
+    static inline void name##_init(name *v) { \
+        v->e = NULL; \
+        v->length = 0; \
+        v->capacity = 0; \
+    } \
+    \
+    static inline void name##_free(name *v) { \
+        free((void*)v->e); \
+        name##_init(v); \
+    } \
+    \
+    static inline void name##_reserve(name *v, int capacity) { \
+        if (capacity > v->capacity) container_grow((void**)&v->e, &v->capacity, capacity, sizeof(T)); \
+    } \
+    \
+    static inline void name##_push(name *v, T element) { \
+        if (v->length == v->capacity) container_grow((void**)&v->e, &v->capacity, v->length + 1, sizeof(T)); \
+        v->e[v->length++] = element; \
+    } \
+    \
+    static inline T name##_pop(name *v) { \
+        return v->e[--v->length]; \
+    } \
+    \
+    static inline T* name##_at(name *v, int i) { \
+        return &v->e[i]; \
+    } \
+    \
+    static inline T* name##_peek(name *v) { \
+        return &v->e[v->length - 1]; \
+    } \
+    \
+    static inline void name##_clear(name *v) { \
+        v->length = 0; \
+    } \
+    \
+    static inline void name##_swap(name *v, int i, int j) { \
+        T tmp = v->e[i]; \
+        v->e[i] = v->e[j]; \
+        v->e[j] = tmp; \
+    }
+
+// A binary min-heap of T called name, ordered by the member key, with
+// name_push(), name_pop() and name_peek()
+#define HEAP_DEFINE(name, T, key) \
+    typedef struct { \
+        T *e; \
+        int length; \
+        int capacity; \
+    } name; \
+    \
+    static inline void name##_init(name *h) { \
+        h->e = NULL; \
+        h->length = 0; \
+        h->capacity = 0; \
+    } \
+    \
+    static inline void name##_free(name *h) { \
+        free((void*)h->e); \
+        name##_init(h); \
+    } \
+    \
+    static inline void name##_push(name *h, T element) { \
+        if (h->length == h->capacity) container_grow((void**)&h->e, &h->capacity, h->length + 1, sizeof(T)); \
+        int i = h->length++; \
+        while (i > 0) { \
+            int parent = (i - 1) / 2; \
+            if (h->e[parent].key <= element.key) break; \
+            h->e[i] = h->e[parent]; \
+            i = parent; \
+        } \
+        h->e[i] = element; \
+    } \
+    \
+    static inline T* name##_peek(name *h) { \
+        return &h->e[0]; \
+    } \
+    \
+    static inline T name##_pop(name *h) { \
+        T top = h->e[0]; \
+        T last = h->e[--h->length]; \
+        int i = 0; \
+        for (;;) { \
+            int child = 2*i + 1; \
+            if (child >= h->length) break; \
+            if (child + 1 < h->length && h->e[child + 1].key < h->e[child].key) child++; \
+            if (last.key <= h->e[child].key) break; \
+            h->e[i] = h->e[child]; \
+            i = child; \
+        } \
+        if (h->length > 0) h->e[i] = last; \
+        return top; \
+    }
+
+VECTOR_DEFINE(int_vector, int)
+
+#endif
@@ -0,0 +1,20 @@
+#include "coroutine.h"
+
+// next_firing() for a coroutine agent: report what the last yield asked
+// for, arming the listeners it's waiting on. wake() gets the agent's state
+// and should hand the agent's coroutine to coroutine_wake().
+int coroutine_next_firing(struct coroutine *co, struct event_listener *listeners, bool (*wake)(void *)) {
+    for (int i = 0; i < SENSORY_EVENT_COUNT; i++) {
+        if (co->events & SENSE(i)) listeners[i].handler = wake;
+    }
+    return co->delay;
+}
+
+// Resume a coroutine waiting on an event right away. Returns whether the
+// agent needs rescheduling, as listener handlers do.
+bool coroutine_wake(struct coroutine *co) {
+    if (co->events == 0) return false;
+    co->events = 0;
+    co->delay = 0;
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <limits.h>
+#include <stdbool.h>
+
+#include "simulation.h"
+
+// Stackless coroutines for agent behaviours. A behaviour is a fire()
+// function with its body between CO_BEGIN and CO_END, which can hand
+// control back to the scheduler part way through and carry on from the
+// same spot on its next firing. Locals don't survive a yield, so keep
+// anything needed afterwards in the agent's state, and don't yield from
+// inside a switch of the behaviour's own.
+struct coroutine {
+    int resume; // __LINE__ of the last yield, 0 to start from the top
+    int delay;  // ticks asked for by the last yield, INT_MAX for an event
+    int events; // mask of sensory events being waited on, 0 for none
+};
+
+#define COROUTINE_INIT { .resume = 0, .delay = 0, .events = 0 }
+
+// Mask bit for a sensory event, for CO_WAIT_ANY
+#define SENSE(sensory_event) (1 << (sensory_event))
+
+#define CO_BEGIN(co) switch ((co)->resume) { case 0:
+
+// Give up the rest of this firing and resume after the given ticks
+#define CO_WAIT(co, ticks) \
+    do { \
+        (co)->resume = __LINE__; \
+        (co)->delay = (ticks); \
+        (co)->events = 0; \
+        return; \
+        case __LINE__:; \
+    } while (0)
+
+// Give up the rest of this firing and resume once any of a mask of
+// sensory events reaches the agent
+#define CO_WAIT_ANY(co, sensory_mask) \
+    do { \
+        (co)->resume = __LINE__; \
+        (co)->delay = INT_MAX; \
+        (co)->events = (sensory_mask); \
+        return; \
+        case __LINE__:; \
+    } while (0)
+
+#define CO_WAIT_EVENT(co, sensory_event) CO_WAIT_ANY(co, SENSE(sensory_event))
+
+// Resume after the given ticks, or sooner if any of the events arrives
+#define CO_WAIT_UNTIL(co, ticks, sensory_mask) \
+    do { \
+        (co)->resume = __LINE__; \
+        (co)->delay = (ticks); \
+        (co)->events = (sensory_mask); \
+        return; \
+        case __LINE__:; \
+    } while (0)
+
+// Falling off the end starts the behaviour over on the next firing, which
+// comes after the last delay again
+#define CO_END(co) } (co)->resume = 0
+
+int coroutine_next_firing(struct coroutine *co, struct event_listener *listeners, bool (*wake)(void *));
+bool coroutine_wake(struct coroutine *co);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdint.h>
+
+typedef int64_t sim_clock;
+#define CLOCK_NEVER INT64_MAX
+
+// Agents live in a vector that moves as it grows, so anything holding on to
+// an agent keeps a handle. The generation goes stale once the slot is reused.
+typedef struct {
+    int index;
+    int generation;
+} agent_handle;
+
+#define NO_AGENT ((agent_handle){ .index = -1, .generation = 0 })
+
+// Each agent owns one event for its whole life. The queues keep queue_index
+// up to date as they move it, so it can be rescheduled where it sits.
+struct event {
+    agent_handle agent;
+    sim_clock clock;
+    // Position in the queue, or -1 while the event isn't queued
+    int queue_index;
+    struct event *next_free;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "event_queue.h"
+
+#define EVENT_QUEUE_INITIAL_CAPACITY 64
+
+event_queue* make_event_queue(void) {
+    event_queue *q = malloc(sizeof(event_queue));
+    if (q == NULL) exit(1);
+    q->e = NULL;
+    q->length = 0;
+    q->capacity = 0;
+    q->events = NULL;
+    q->position = NULL;
+    q->free_ids = NULL;
+    q->free_count = 0;
+    q->id_count = 0;
+    return q;
+}
+
+void destroy_event_queue(event_queue *q) {
+    free((void*)q->e);
+    free((void*)q->events);
+    free((void*)q->position);
+    free((void*)q->free_ids);
+    free((void*)q);
+}
+
+static void set_entry(event_queue *q, int i, event_queue_entry entry) {
+    q->e[i] = entry;
+    q->position[entry.id] = i;
+}
+
+// Every id in use is either queued or free, so there are never more than
+// capacity of them
+static int take_id(event_queue *q) {
+    if (q->free_count > 0) return q->free_ids[--q->free_count];
+    return q->id_count++;
+}
+
+static void release_id(event_queue *q, int id) {
+    q->free_ids[q->free_count++] = id;
+}
+
+// Both sifts carry the moving entry in a local and shift the other entries
+// into the hole, so each level costs one copy instead of a swap.
+static void sift_up(event_queue *q, int i, event_queue_entry entry) {
+    while (i > 0) {
+        int parent = (i - 1) / EVENT_QUEUE_ARITY;
+        if (q->e[parent].clock <= entry.clock) break;
+        set_entry(q, i, q->e[parent]);
+        i = parent;
+    }
+    set_entry(q, i, entry);
+}
+
+static void sift_down(event_queue *q, int i, event_queue_entry entry) {
+    while (true) {
+        int first = i * EVENT_QUEUE_ARITY + 1;
+        if (first >= q->length) break;
+
+        int last = first + EVENT_QUEUE_ARITY;
+        if (last > q->length) last = q->length;
+
+        int best = first;
+        for (int c = first + 1; c < last; c++) {
+            if (q->e[c].clock < q->e[best].clock) best = c;
+        }
+
+        if (q->e[best].clock >= entry.clock) break;
+        set_entry(q, i, q->e[best]);
+        i = best;
+    }
+    set_entry(q, i, entry);
+}
+
+// Put entry at i, moving it whichever way restores heap order
+static void sift(event_queue *q, int i, event_queue_entry entry) {
+    if (i > 0 && q->e[(i - 1) / EVENT_QUEUE_ARITY].clock > entry.clock) {
+        sift_up(q, i, entry);
+    } else {
+        sift_down(q, i, entry);
+    }
+}
+
+void event_queue_push(event_queue *q, struct event *event, sim_clock clock) {
+    if (q->length == q->capacity) {
+        int capacity = q->capacity == 0 ? EVENT_QUEUE_INITIAL_CAPACITY : q->capacity * 2;
+        q->e = realloc(q->e, capacity * sizeof(event_queue_entry));
+        q->events = realloc(q->events, capacity * sizeof(struct event*));
+        q->position = realloc(q->position, capacity * sizeof(int));
+        q->free_ids = realloc(q->free_ids, capacity * sizeof(int));
+        if (q->e == NULL || q->events == NULL || q->position == NULL || q->free_ids == NULL) exit(1);
+        q->capacity = capacity;
+    }
+
+    event_queue_entry entry;
+    entry.clock = clock;
+    entry.id = take_id(q);
+    q->events[entry.id] = event;
+    event->queue_index = entry.id;
+    event->clock = clock;
+    q->length++;
+    sift_up(q, q->length - 1, entry);
+}
+
+void event_queue_peek(event_queue *q, struct event **event, sim_clock *clock) {
+    if (q->length == 0) {
+        *event = NULL;
+        *clock = CLOCK_NEVER;
+        return;
+    }
+    *event = q->events[q->e[0].id];
+    *clock = q->e[0].clock;
+}
+
+void event_queue_pop(event_queue *q, struct event **event, sim_clock *clock) {
+    event_queue_peek(q, event, clock);
+    if (q->length == 0) return;
+
+    int id = q->e[0].id;
+    (*event)->queue_index = -1;
+    q->length--;
+    if (q->length > 0) {
+        sift_down(q, 0, q->e[q->length]);
+    }
+    release_id(q, id);
+}
+
+// Move a queued event to a new clock in place, O(log n) either direction
+void event_queue_update(event_queue *q, struct event *event, sim_clock clock) {
+    event_queue_entry entry;
+    entry.clock = clock;
+    entry.id = event->queue_index;
+    event->clock = clock;
+    sift(q, q->position[entry.id], entry);
+}
+
+void event_queue_remove(event_queue *q, struct event *event) {
+    int id = event->queue_index;
+    int i = q->position[id];
+    event->queue_index = -1;
+
+    q->length--;
+    if (i < q->length) {
+        sift(q, i, q->e[q->length]);
+    }
+    release_id(q, id);
+}
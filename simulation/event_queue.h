@@ -0,0 +1,46 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include "event.h"
+
+// Number of children per node. Four keeps a node's children on one cache
+// line and halves the tree depth compared to a binary heap.
+#define EVENT_QUEUE_ARITY 4
+
+// Entries name their event by an id the queue hands out and keeps in the
+// event's queue_index. Where each id sits in the heap is kept in a side
+// array, so a sift writes only to the heap and that array and never
+// touches the events themselves. Freed ids are handed out again first, so
+// an event popped and pushed straight back keeps its id warm.
+//
+// Against mheap in bench_event_queue this wins up to about 10k events,
+// which covers a level's one event per mob, and loses from 100k on, where
+// the position write at every sift level misses cache. The simulation
+// keeps it for the in-place update and remove mheap can't do.
+typedef struct {
+    sim_clock clock;
+    int id;
+} event_queue_entry;
+
+typedef struct {
+    event_queue_entry *e;
+    int length;
+    int capacity;
+    // Indexed by id
+    struct event **events;
+    int *position;
+    // Ids free for reuse, and how many have ever been handed out
+    int *free_ids;
+    int free_count;
+    int id_count;
+} event_queue;
+
+event_queue* make_event_queue(void);
+void destroy_event_queue(event_queue *q);
+void event_queue_push(event_queue *q, struct event *event, sim_clock clock);
+void event_queue_pop(event_queue *q, struct event **event, sim_clock *clock);
+void event_queue_peek(event_queue *q, struct event **event, sim_clock *clock);
+void event_queue_update(event_queue *q, struct event *event, sim_clock clock);
+void event_queue_remove(event_queue *q, struct event *event);
+
+#endif
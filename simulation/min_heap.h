@@ -1,13 +1,14 @@
 #ifndef MIN_HEAP_H
 #define MIN_HEAP_H
 
-#include "vector.h"
+#include "containers.h"
 
 typedef struct {
     int value;
     void* data;
 } mheap_element;
-typedef vector mheap;
+HEAP_DEFINE(mheap_storage, mheap_element, value)
+typedef mheap_storage mheap;
 
 void mheap_push(mheap *h, void *data, int priority);
 void mheap_pop(mheap *h, void** data, int* priority);
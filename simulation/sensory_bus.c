@@ -0,0 +1,73 @@
+#include <stdlib.h>
+
+#include "sensory_bus.h"
+
+struct sensory_bus* make_sensory_bus(struct spatial_index *index) {
+    struct sensory_bus *bus = malloc(sizeof(struct sensory_bus));
+    if (bus == NULL) exit(1);
+    bus->index = index;
+    subscriber_vector_init(&bus->subscribers);
+    return bus;
+}
+
+void destroy_sensory_bus(struct sensory_bus *bus) {
+    subscriber_vector_free(&bus->subscribers);
+    free((void*)bus);
+}
+
+// Listen on behalf of the index entry id. Unsubscribe before removing the
+// entry, as the index recycles ids.
+void sensory_bus_subscribe(struct sensory_bus *bus, int id, agent_handle agent, struct event_listener *listeners) {
+    struct subscriber none = { .agent = NO_AGENT, .listeners = NULL };
+    while (bus->subscribers.length <= id) subscriber_vector_push(&bus->subscribers, none);
+    bus->subscribers.e[id].agent = agent;
+    bus->subscribers.e[id].listeners = listeners;
+}
+
+void sensory_bus_unsubscribe(struct sensory_bus *bus, int id) {
+    bus->subscribers.e[id].agent = NO_AGENT;
+    bus->subscribers.e[id].listeners = NULL;
+}
+
+struct bus_visit {
+    struct sensory_bus *bus;
+    void (*visit)(void *context, struct subscriber *s);
+    void *context;
+};
+
+static void visit_entry(void *context, int id) {
+    struct bus_visit *v = (struct bus_visit*)context;
+    if (id >= v->bus->subscribers.length) return;
+    struct subscriber *s = &v->bus->subscribers.e[id];
+    if (s->listeners != NULL) v->visit(v->context, s);
+}
+
+// Call visit() on every subscriber within radius of (x, y). It mustn't
+// subscribe, unsubscribe or move anything in the index.
+void sensory_bus_visit(struct sensory_bus *bus, int x, int y, int radius, void (*visit)(void *context, struct subscriber *s), void *context) {
+    struct bus_visit v = { .bus = bus, .visit = visit, .context = context };
+    spatial_index_visit(bus->index, x, y, radius, visit_entry, (void*)&v);
+}
+
+struct delivery {
+    struct simulation *sim;
+    enum sensory_events event;
+    int delivered;
+};
+
+static void deliver(void *context, struct subscriber *s) {
+    struct delivery *d = (struct delivery*)context;
+    if (simulation_get_agent(d->sim, s->agent) != NULL && s->listeners[d->event].handler != NULL) {
+        simulation_call_event_handler(d->sim, &s->listeners[d->event]);
+        d->delivered++;
+    }
+}
+
+// Hand the event to every subscriber within radius of (x, y) that is
+// listening for it, as simulation_call_event_handler does. Returns how many
+// were told.
+int sensory_bus_publish(struct sensory_bus *bus, struct simulation *sim, enum sensory_events event, int x, int y, int radius) {
+    struct delivery d = { .sim = sim, .event = event, .delivered = 0 };
+    sensory_bus_visit(bus, x, y, radius, deliver, (void*)&d);
+    return d.delivered;
+}
@@ -0,0 +1,35 @@
+#ifndef SENSORY_BUS_H
+#define SENSORY_BUS_H
+
+#include "simulation.h"
+#include "containers.h"
+#include "spatial_index.h"
+
+// Agents listening for events published with a radius. The bus keeps no
+// positions of its own: it sits on a spatial index and hangs a subscriber
+// off an entry's id, so moving the entry in the index moves the
+// subscriber too and publishing only visits the cells it can reach.
+struct subscriber {
+    agent_handle agent;
+    // NULL for entries nobody subscribed
+    struct event_listener *listeners;
+};
+
+VECTOR_DEFINE(subscriber_vector, struct subscriber)
+
+struct sensory_bus {
+    // Not owned
+    struct spatial_index *index;
+    // Indexed by entry id
+    subscriber_vector subscribers;
+};
+
+struct sensory_bus* make_sensory_bus(struct spatial_index *index);
+void destroy_sensory_bus(struct sensory_bus *bus);
+
+void sensory_bus_subscribe(struct sensory_bus *bus, int id, agent_handle agent, struct event_listener *listeners);
+void sensory_bus_unsubscribe(struct sensory_bus *bus, int id);
+void sensory_bus_visit(struct sensory_bus *bus, int x, int y, int radius, void (*visit)(void *context, struct subscriber *s), void *context);
+int sensory_bus_publish(struct sensory_bus *bus, struct simulation *sim, enum sensory_events event, int x, int y, int radius);
+
+#endif
@@ -0,0 +1,55 @@
+#include <string.h>
+#include <time.h>
+
+#include "sim_stats.h"
+
+void reset_sim_stats(struct sim_stats *stats) {
+    memset((void*)stats, 0, sizeof(struct sim_stats));
+}
+
+void histogram_add(struct histogram *h, int64_t value) {
+    int bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS - 1 && value >= ((int64_t)1 << bucket)) bucket++;
+    h->buckets[bucket]++;
+    h->count++;
+    h->total += value;
+    if (value > h->max) h->max = value;
+}
+
+int64_t stats_now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+static void dump_histogram(const char *name, const struct histogram *h, int (*print)(const char *format, ...)) {
+    if (h->count == 0) {
+        print("%s: none\n", name);
+        return;
+    }
+    print("%s: count %lld mean %.1f max %lld\n", name, (long long)h->count, (double)h->total / h->count, (long long)h->max);
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (h->buckets[i] == 0) continue;
+        int64_t low = i == 0 ? 0 : (int64_t)1 << (i - 1);
+        print("    >= %-8lld %lld\n", (long long)low, (long long)h->buckets[i]);
+    }
+}
+
+// Write the stats out a line at a time through a printf-like function,
+// such as logger()
+void dump_sim_stats(const struct sim_stats *stats, int (*print)(const char *format, ...)) {
+    print("Simulation stats over %lld syncs\n", (long long)stats->syncs);
+    print("events fired %lld, stale pops %lld, sleeps %lld, batch planning %.3f ms\n",
+            (long long)stats->events_fired, (long long)stats->stale_pops,
+            (long long)stats->sleeps, stats->plan_ns / 1e6);
+    dump_histogram("events per sync", &stats->events_per_sync, print);
+    dump_histogram("queue length", &stats->queue_length, print);
+    dump_histogram("reschedule latency (ticks)", &stats->reschedule_latency, print);
+    for (int i = 0; i < SIM_STATS_KINDS; i++) {
+        const struct kind_stats *k = &stats->kinds[i];
+        if (k->fired == 0 && k->scheduled == 0) continue;
+        print("kind %d: fired %lld (%.3f ms), scheduled %lld (%.3f ms)\n", i,
+                (long long)k->fired, k->fire_ns / 1e6,
+                (long long)k->scheduled, k->next_firing_ns / 1e6);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef SIM_STATS_H
+#define SIM_STATS_H
+
+#include <stdint.h>
+
+// Histograms bucket by powers of two. Bucket 0 holds zero, bucket i holds
+// 2^(i-1) up to 2^i and the last bucket takes everything larger.
+#define HISTOGRAM_BUCKETS 24
+
+// Agent kinds tracked separately, higher kinds share the last entry
+#define SIM_STATS_KINDS 8
+
+struct histogram {
+    int64_t count;
+    int64_t total;
+    int64_t max;
+    int64_t buckets[HISTOGRAM_BUCKETS];
+};
+
+struct kind_stats {
+    int64_t fired;
+    int64_t scheduled;
+    // Wall clock spent inside the agent's callbacks. Batched agents count
+    // apply() as firing, their plan() runs elsewhere and is in plan_ns.
+    int64_t fire_ns;
+    int64_t next_firing_ns;
+};
+
+// What the scheduler has been doing since stats were turned on
+struct sim_stats {
+    int64_t syncs;
+    int64_t events_fired;
+    // Events popped for an agent that had retired, or that an earlier
+    // firing in the same batch had already rescheduled
+    int64_t stale_pops;
+    // Events that went to sleep until a listener wakes them
+    int64_t sleeps;
+    // Time spent planning batches on the worker pool
+    int64_t plan_ns;
+    struct histogram events_per_sync;
+    // Pending events at the start of each sync
+    struct histogram queue_length;
+    // Ticks between scheduling an event and its firing time
+    struct histogram reschedule_latency;
+    struct kind_stats kinds[SIM_STATS_KINDS];
+};
+
+void reset_sim_stats(struct sim_stats *stats);
+void histogram_add(struct histogram *h, int64_t value);
+int64_t stats_now_ns(void);
+void dump_sim_stats(const struct sim_stats *stats, int (*print)(const char *format, ...));
+
+#endif
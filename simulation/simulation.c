@@ -5,71 +5,398 @@
 
 #include "simulation.h"
 
+#define EVENT_BLOCK_SIZE 256
+
+
 struct simulation* make_simulation(void* context) {
+    return make_simulation_with_queue(context, HEAP_QUEUE, 0);
+}
+
+struct simulation* make_simulation_with_queue(void* context, enum queue_type type, sim_clock slot_width) {
     struct simulation *sim;
     sim = malloc(sizeof(struct simulation));
-    sim->agents = make_vector(sizeof(struct agent));
-    sim->queue = make_mheap(sizeof(struct event));
+    agent_vector_init(&sim->agents);
+    sim->queue_type = type;
+    sim->queue = NULL;
+    sim->wheel = NULL;
+    switch (type) {
+        case HEAP_QUEUE:
+            sim->queue = make_event_queue();
+            break;
+        case WHEEL_QUEUE:
+            sim->wheel = make_timing_wheel(slot_width);
+            break;
+    }
     sim->current_clock = 0;
+    sim->lod = NULL;
     sim->context = context;
+    sim->free_events = NULL;
+    event_vector_init(&sim->event_blocks);
+    int_vector_init(&sim->free_agents);
+    sim->workers = NULL;
+    event_vector_init(&sim->batch);
+    intent_vector_init(&sim->intents);
+    plan_slot_vector_init(&sim->plan_order);
+    sim->stats = NULL;
     return sim;
 }
 
 void destroy_simulation(struct simulation *sim) {
-    struct event *e;
-    int clock;
-
-    destroy_vector(sim->agents);
-    while (sim->queue->length > 0) {
-        mheap_pop(sim->queue, (void**)&e, &clock);
-        free((void*)e);
+    agent_vector_free(&sim->agents);
+    if (sim->queue != NULL) destroy_event_queue(sim->queue);
+    if (sim->wheel != NULL) destroy_timing_wheel(sim->wheel);
+    for (int i = 0; i < sim->event_blocks.length; i++) {
+        free((void*)sim->event_blocks.e[i]);
     }
-    destroy_mheap(sim->queue);
+    event_vector_free(&sim->event_blocks);
+    int_vector_free(&sim->free_agents);
+    if (sim->workers != NULL) destroy_worker_pool(sim->workers);
+    event_vector_free(&sim->batch);
+    intent_vector_free(&sim->intents);
+    plan_slot_vector_free(&sim->plan_order);
+    free((void*)sim->stats);
     free((void*)sim);
 }
 
-void simulation_push_agent(struct simulation *sim, struct agent *a) {
-    vector_push(sim->agents, (void*)a);
+// Zero threads goes back to firing events one at a time
+void simulation_set_workers(struct simulation *sim, int thread_count) {
+    if (sim->workers != NULL) destroy_worker_pool(sim->workers);
+    sim->workers = thread_count > 0 ? make_worker_pool(thread_count) : NULL;
+}
+
+void simulation_set_lod(struct simulation *sim, int (*lod)(void *context, void *agent, int delay)) {
+    sim->lod = lod;
+}
+
+// Start counting from zero. Counting is cheap, but timing the callbacks
+// reads the clock twice per firing.
+void simulation_enable_stats(struct simulation *sim) {
+    if (sim->stats == NULL) {
+        sim->stats = malloc(sizeof(struct sim_stats));
+        if (sim->stats == NULL) exit(1);
+    }
+    reset_sim_stats(sim->stats);
+}
+
+// NULL if stats were never enabled
+const struct sim_stats* simulation_get_stats(struct simulation *sim) {
+    return sim->stats;
 }
 
-void schedule_event(struct simulation *sim, struct agent* a, int clock) {
+static struct kind_stats* stats_for_kind(struct simulation *sim, int kind) {
+    if (kind < 0) kind = 0;
+    if (kind >= SIM_STATS_KINDS) kind = SIM_STATS_KINDS - 1;
+    return &sim->stats->kinds[kind];
+}
+
+static struct event* take_event(struct simulation *sim) {
+    if (sim->free_events == NULL) {
+        // Pool is dry, carve up a new block. Blocks are never moved so
+        // listeners can keep pointing at their events.
+        struct event *block = malloc(EVENT_BLOCK_SIZE * sizeof(struct event));
+        if (block == NULL) exit(1);
+        event_vector_push(&sim->event_blocks, block);
+        for (int i = 0; i < EVENT_BLOCK_SIZE; i++) {
+            block[i].next_free = sim->free_events;
+            sim->free_events = &block[i];
+        }
+    }
+
+    struct event *e = sim->free_events;
+    sim->free_events = e->next_free;
+    return e;
+}
+
+static void release_event(struct simulation *sim, struct event *e) {
+    e->next_free = sim->free_events;
+    sim->free_events = e;
+}
+
+static void queue_push(struct simulation *sim, struct event *e, sim_clock clock) {
+    switch (sim->queue_type) {
+        case HEAP_QUEUE:
+            event_queue_push(sim->queue, e, clock);
+            break;
+        case WHEEL_QUEUE:
+            timing_wheel_push(sim->wheel, e, clock);
+            break;
+    }
+}
+
+static void queue_pop(struct simulation *sim, struct event **e, sim_clock *clock) {
+    switch (sim->queue_type) {
+        case HEAP_QUEUE:
+            event_queue_pop(sim->queue, e, clock);
+            break;
+        case WHEEL_QUEUE:
+            timing_wheel_pop(sim->wheel, e, clock);
+            break;
+    }
+}
+
+static void queue_peek(struct simulation *sim, struct event **e, sim_clock *clock) {
+    switch (sim->queue_type) {
+        case HEAP_QUEUE:
+            event_queue_peek(sim->queue, e, clock);
+            break;
+        case WHEEL_QUEUE:
+            timing_wheel_peek(sim->wheel, e, clock);
+            break;
+    }
+}
+
+static int queue_length(struct simulation *sim) {
+    switch (sim->queue_type) {
+        case HEAP_QUEUE:
+            return sim->queue->length;
+        case WHEEL_QUEUE:
+            return sim->wheel->length;
+    }
+    return 0;
+}
+
+static void queue_update(struct simulation *sim, struct event *e, sim_clock clock) {
+    switch (sim->queue_type) {
+        case HEAP_QUEUE:
+            event_queue_update(sim->queue, e, clock);
+            break;
+        case WHEEL_QUEUE:
+            timing_wheel_update(sim->wheel, e, clock);
+            break;
+    }
+}
+
+static void queue_remove(struct simulation *sim, struct event *e) {
+    switch (sim->queue_type) {
+        case HEAP_QUEUE:
+            event_queue_remove(sim->queue, e);
+            break;
+        case WHEEL_QUEUE:
+            timing_wheel_remove(sim->wheel, e);
+            break;
+    }
+}
+
+agent_handle simulation_push_agent(struct simulation *sim, struct agent *a) {
+    agent_handle handle;
+    if (sim->free_agents.length > 0) {
+        // Reuse a retired slot, its generation was bumped when it retired
+        handle.index = int_vector_pop(&sim->free_agents);
+        handle.generation = agent_vector_at(&sim->agents, handle.index)->generation;
+    } else {
+        handle.index = sim->agents.length;
+        handle.generation = 0;
+    }
+    a->generation = handle.generation;
+    a->event = take_event(sim);
+    a->event->agent = handle;
+    a->event->queue_index = -1;
+    for (int i = 0; i < SENSORY_EVENT_COUNT; i++) a->listeners[i].owner = a->event;
+    if (handle.index < sim->agents.length) {
+        *agent_vector_at(&sim->agents, handle.index) = *a;
+    } else {
+        agent_vector_push(&sim->agents, *a);
+    }
+    return handle;
+}
+
+// Cancel the agent's pending event and free its slot for the next push.
+// Outstanding handles to it go stale. Don't call this from inside a
+// firing, retire between syncs.
+void simulation_retire_agent(struct simulation *sim, agent_handle handle) {
+    struct agent *a = simulation_get_agent(sim, handle);
+    if (a == NULL) return;
+
+    if (a->event->queue_index >= 0) queue_remove(sim, a->event);
+    release_event(sim, a->event);
+    a->event = NULL;
+    a->state = NULL;
+    a->generation++;
+    int_vector_push(&sim->free_agents, handle.index);
+}
+
+struct agent* simulation_get_agent(struct simulation *sim, agent_handle handle) {
+    if (handle.index < 0 || handle.index >= sim->agents.length) return NULL;
+    struct agent *a = agent_vector_at(&sim->agents, handle.index);
+    if (a->generation != handle.generation) return NULL;
+    return a;
+}
+
+void schedule_event(struct simulation *sim, agent_handle handle, sim_clock clock) {
+    struct agent *a = simulation_get_agent(sim, handle);
+    if (a == NULL) return;
+
     for (int i = 0; i < SENSORY_EVENT_COUNT; i++) a->listeners[i].handler = NULL;
 
-    int next_firing = a->next_firing(sim->context, a->state, a->listeners);
-    // FIXME: This doesn't guarentee that it won't overflow
-    if (next_firing < INT_MAX) next_firing += clock;
-    struct event *e = malloc(sizeof(struct event));
-    e->valid = true;
-    e->agent = a;
-    for (int i = 0; i < SENSORY_EVENT_COUNT; i++) a->listeners[i].owner = e;
+    // Agents report a delay, INT_MAX meaning they only wake on a listener
+    int64_t start = sim->stats != NULL ? stats_now_ns() : 0;
+    int delay = a->next_firing(sim->context, a->state, a->listeners);
+    if (sim->lod != NULL && delay != INT_MAX) delay = sim->lod(sim->context, a->state, delay);
+    sim_clock next_firing = (delay == INT_MAX) ? CLOCK_NEVER : clock + delay;
+
+    if (sim->stats != NULL) {
+        struct kind_stats *k = stats_for_kind(sim, a->kind);
+        k->scheduled++;
+        k->next_firing_ns += stats_now_ns() - start;
+        if (delay == INT_MAX) {
+            sim->stats->sleeps++;
+        } else {
+            histogram_add(&sim->stats->reschedule_latency, delay);
+        }
+    }
+
+    // An agent only ever has its one event, so a queued one just moves
+    if (a->event->queue_index >= 0) {
+        queue_update(sim, a->event, next_firing);
+    } else {
+        queue_push(sim, a->event, next_firing);
+    }
+}
+
+static int compare_batch_events(const void *a, const void *b) {
+    return (*(struct event**)a)->agent.index - (*(struct event**)b)->agent.index;
+}
+
+static int compare_plan_slots(const void *a, const void *b) {
+    const struct plan_slot *sa = (const struct plan_slot*)a;
+    const struct plan_slot *sb = (const struct plan_slot*)b;
+    if (sa->kind != sb->kind) return sa->kind - sb->kind;
+    return sa->position - sb->position;
+}
+
+static void plan_task(void *vsim, int i) {
+    struct simulation *sim = (struct simulation*)vsim;
+    int position = sim->plan_order.e[i].position;
+    struct event *e = sim->batch.e[position];
+    struct agent *a = simulation_get_agent(sim, e->agent);
+    struct intent *intent = &sim->intents.e[position];
+
+    intent->action = 0;
+    intent->dx = 0;
+    intent->dy = 0;
+    if (a != NULL && a->plan != NULL) a->plan(sim->context, a->state, intent);
+}
+
+// Fire or apply, counting and timing it when stats are on. The agent
+// pointer is stale afterwards, firing may spawn agents and move the vector.
+static void fire_agent(struct simulation *sim, struct agent *a, struct intent *intent) {
+    if (sim->stats == NULL) {
+        if (intent != NULL) {
+            a->apply(sim->context, a->state, intent);
+        } else {
+            a->fire(sim->context, a->state);
+        }
+        return;
+    }
 
-    mheap_push(sim->queue, (void*)e, next_firing);
+    struct kind_stats *k = stats_for_kind(sim, a->kind);
+    int64_t start = stats_now_ns();
+    if (intent != NULL) {
+        a->apply(sim->context, a->state, intent);
+    } else {
+        a->fire(sim->context, a->state);
+    }
+    k->fire_ns += stats_now_ns() - start;
+    k->fired++;
+    sim->stats->events_fired++;
 }
 
-void sync_simulation(struct simulation *sim, int stop_time) {
+// Pop every event due at the next clock, plan them all on the worker pool
+// against the same world, then apply the intents in agent order so the
+// outcome doesn't depend on thread timing. Planning goes kind by kind so
+// neighbouring calls run the same behaviour.
+static int sync_batches(struct simulation *sim, sim_clock stop_time) {
     struct event *e;
+    sim_clock clock;
+    struct intent blank = { 0 };
     int event_count = 0;
 
-    if (sim->queue->length > 0) {
-        mheap_peek(sim->queue, (void**)&e, &sim->current_clock);
-        while (sim->current_clock <= stop_time) {
+    queue_peek(sim, &e, &clock);
+    while (e != NULL && clock <= stop_time) {
+        sim->current_clock = clock;
+        event_vector_clear(&sim->batch);
+        intent_vector_clear(&sim->intents);
+        while (e != NULL && clock == sim->current_clock) {
+            queue_pop(sim, &e, &clock);
+            event_vector_push(&sim->batch, e);
+            intent_vector_push(&sim->intents, blank);
+            queue_peek(sim, &e, &clock);
+        }
+        qsort(sim->batch.e, sim->batch.length, sizeof(struct event*), compare_batch_events);
+
+        plan_slot_vector_clear(&sim->plan_order);
+        for (int i = 0; i < sim->batch.length; i++) {
+            e = sim->batch.e[i];
+            struct agent *a = simulation_get_agent(sim, e->agent);
+            struct plan_slot slot = { .kind = a != NULL ? a->kind : 0, .position = i };
+            plan_slot_vector_push(&sim->plan_order, slot);
+        }
+        qsort(sim->plan_order.e, sim->plan_order.length, sizeof(struct plan_slot), compare_plan_slots);
+
+        int64_t start = sim->stats != NULL ? stats_now_ns() : 0;
+        worker_pool_run(sim->workers, plan_task, (void*)sim, sim->batch.length);
+        if (sim->stats != NULL) sim->stats->plan_ns += stats_now_ns() - start;
+
+        for (int i = 0; i < sim->batch.length; i++) {
+            e = sim->batch.e[i];
+            struct agent *a = simulation_get_agent(sim, e->agent);
+            // Skip agents retired or rescheduled by an earlier apply in this batch
+            if (a == NULL || e->queue_index >= 0) {
+                if (sim->stats != NULL) sim->stats->stale_pops++;
+                continue;
+            }
             event_count++;
-            mheap_pop(sim->queue, (void**)&e, &sim->current_clock);
-            if (e->valid) {
-                e->agent->fire(sim->context, e->agent->state);
-                schedule_event(sim, e->agent, sim->current_clock);
+            fire_agent(sim, a, a->plan != NULL ? &sim->intents.e[i] : NULL);
+            if (e->queue_index < 0) schedule_event(sim, e->agent, sim->current_clock);
+        }
+        queue_peek(sim, &e, &clock);
+    }
+    return event_count;
+}
+
+void sync_simulation(struct simulation *sim, sim_clock stop_time) {
+    struct event *e;
+    sim_clock clock;
+    int event_count = 0;
+
+    if (sim->stats != NULL) {
+        sim->stats->syncs++;
+        histogram_add(&sim->stats->queue_length, queue_length(sim));
+    }
+
+    if (sim->workers != NULL) {
+        event_count = sync_batches(sim, stop_time);
+    } else {
+        queue_peek(sim, &e, &clock);
+        while (e != NULL && clock <= stop_time) {
+            queue_pop(sim, &e, &sim->current_clock);
+            struct agent *a = simulation_get_agent(sim, e->agent);
+            if (a != NULL) {
+                event_count++;
+                fire_agent(sim, a, NULL);
+                // fire() may spawn agents and move the vector, so schedule by
+                // handle. A listener triggered during fire() may already have.
+                if (e->queue_index < 0) schedule_event(sim, e->agent, sim->current_clock);
+            } else if (sim->stats != NULL) {
+                sim->stats->stale_pops++;
             }
-            free((void*)e);
-            mheap_peek(sim->queue, (void**)&e, &sim->current_clock);
+            queue_peek(sim, &e, &clock);
         }
     }
+
+    if (sim->stats != NULL) histogram_add(&sim->stats->events_per_sync, event_count);
 }
 
 void simulation_call_event_handler(struct simulation *sim, struct event_listener *listener) {
-    bool do_cancel = listener->handler((void*)listener->owner->agent->state);
+    struct event *owner = listener->owner;
+    struct agent *a = simulation_get_agent(sim, owner->agent);
+    if (a == NULL) return;
+
+    bool do_cancel = listener->handler(a->state);
 
+    // Rescheduling moves the agent's event within the queue, nothing is
+    // left behind
     if (do_cancel) {
-        listener->owner->valid = false;
-        schedule_event(sim, listener->owner->agent, sim->current_clock);
+        schedule_event(sim, owner->agent, sim->current_clock);
     }
 }
@@ -3,50 +3,107 @@
 
 #include <stdbool.h>
 
-#include "min_heap.h"
-#include "vector.h"
+#include "event.h"
+#include "event_queue.h"
+#include "timing_wheel.h"
+#include "containers.h"
+#include "worker_pool.h"
+#include "sim_stats.h"
 
 enum sensory_events {
     VISION_CHANGE = 0,
     DAMAGE,
+    NOISE,
 };
-#define SENSORY_EVENT_COUNT DAMAGE+1
+#define SENSORY_EVENT_COUNT (NOISE+1)
 
 
-struct agent;
-
-struct event {
-    bool valid;
-    struct agent *agent;
-};
-
 struct event_listener {
     struct event *owner;
     bool (*handler)(void *);
 };
 
+// A decision taken by an agent's plan(), carried out later by its apply().
+// What the fields mean is up to the agent.
+struct intent {
+    int action;
+    int dx;
+    int dy;
+};
+
 struct agent {
     void *state;
+    // Batches plan agents of one kind together, the meaning is the caller's
+    int kind;
     int (*next_firing)(void *context, void *agent, struct event_listener *listeners);
     void (*fire)(void *context, void *agent);
+    // Optional split of fire() for parallel batches. plan() may run on any
+    // thread and must only read shared state, apply() runs on the caller's
+    // thread in agent order.
+    void (*plan)(void *context, void *agent, struct intent *intent);
+    void (*apply)(void *context, void *agent, struct intent *intent);
     struct event_listener *listeners;
+    struct event *event;
+    int generation;
 };
 
+// Where a batched event is planned, kept apart from the apply order
+struct plan_slot {
+    int kind;
+    int position;
+};
+
+VECTOR_DEFINE(agent_vector, struct agent)
+VECTOR_DEFINE(agent_handle_vector, agent_handle)
+VECTOR_DEFINE(event_vector, struct event*)
+VECTOR_DEFINE(intent_vector, struct intent)
+VECTOR_DEFINE(plan_slot_vector, struct plan_slot)
+
+// Which structure orders pending events. The wheel suits firing times that
+// cluster a few slot widths ahead, the heap makes no assumptions.
+enum queue_type {
+    HEAP_QUEUE,
+    WHEEL_QUEUE,
+};
 
 struct simulation {
-    vector *agents;
+    agent_vector agents;
     void *context;
-    mheap *queue;
-    int current_clock;
+    enum queue_type queue_type;
+    event_queue *queue;
+    timing_wheel *wheel;
+    sim_clock current_clock;
+    // Optional policy that stretches the delay an agent asked for
+    int (*lod)(void *context, void *agent, int delay);
+    // Every agent's event comes from these blocks, so spawning an agent
+    // rarely hits the allocator
+    struct event *free_events;
+    event_vector event_blocks;
+    // Slots of retired agents, reused before the agents vector grows
+    int_vector free_agents;
+    // With workers, events sharing a clock are planned in parallel
+    struct worker_pool *workers;
+    event_vector batch;
+    intent_vector intents;
+    plan_slot_vector plan_order;
+    // Scheduler instrumentation, NULL unless turned on
+    struct sim_stats *stats;
 };
 
 struct simulation* make_simulation(void* context);
+struct simulation* make_simulation_with_queue(void* context, enum queue_type type, sim_clock slot_width);
 void destroy_simulation(struct simulation *sim);
+void simulation_set_workers(struct simulation *sim, int thread_count);
+void simulation_set_lod(struct simulation *sim, int (*lod)(void *context, void *agent, int delay));
+void simulation_enable_stats(struct simulation *sim);
+const struct sim_stats* simulation_get_stats(struct simulation *sim);
 
 void simulation_call_event_handler(struct simulation *sim, struct event_listener *listener);
 
-void simulation_push_agent(struct simulation *sim, struct agent *a);
-void schedule_event(struct simulation *sim, struct agent* a, int clock);
-void sync_simulation(struct simulation *sim, int stop_time);
+agent_handle simulation_push_agent(struct simulation *sim, struct agent *a);
+struct agent* simulation_get_agent(struct simulation *sim, agent_handle handle);
+void simulation_retire_agent(struct simulation *sim, agent_handle handle);
+void schedule_event(struct simulation *sim, agent_handle handle, sim_clock clock);
+void sync_simulation(struct simulation *sim, sim_clock stop_time);
 
 #endif
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+
+#include "spatial_index.h"
+
+struct spatial_index* make_spatial_index(int width, int height, int cell_size) {
+    struct spatial_index *index = malloc(sizeof(struct spatial_index));
+    if (index == NULL) exit(1);
+    index->cell_size = cell_size;
+    index->columns = (width + cell_size - 1) / cell_size;
+    index->rows = (height + cell_size - 1) / cell_size;
+    index->cells = malloc(index->columns * index->rows * sizeof(int_vector));
+    if (index->cells == NULL) exit(1);
+    for (int i = 0; i < index->columns * index->rows; i++) int_vector_init(&index->cells[i]);
+    spatial_entry_vector_init(&index->entries);
+    index->free_entry = -1;
+    return index;
+}
+
+void destroy_spatial_index(struct spatial_index *index) {
+    for (int i = 0; i < index->columns * index->rows; i++) int_vector_free(&index->cells[i]);
+    free((void*)index->cells);
+    spatial_entry_vector_free(&index->entries);
+    free((void*)index);
+}
+
+static int clamp(int v, int lo, int hi) {
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+static int cell_of(struct spatial_index *index, int x, int y) {
+    int column = clamp(x / index->cell_size, 0, index->columns - 1);
+    int row = clamp(y / index->cell_size, 0, index->rows - 1);
+    return row * index->columns + column;
+}
+
+static void link_entry(struct spatial_index *index, int id) {
+    struct spatial_entry *e = spatial_index_get(index, id);
+    e->cell = cell_of(index, e->x, e->y);
+    e->slot = index->cells[e->cell].length;
+    int_vector_push(&index->cells[e->cell], id);
+}
+
+// Take the entry out of its cell, moving the cell's last id into its slot
+static void unlink_entry(struct spatial_index *index, int id) {
+    struct spatial_entry *e = spatial_index_get(index, id);
+    int_vector *cell = &index->cells[e->cell];
+    int last = int_vector_pop(cell);
+    if (last != id) {
+        cell->e[e->slot] = last;
+        spatial_index_get(index, last)->slot = e->slot;
+    }
+}
+
+// Returns an id for moving and removing, recycled after remove
+int spatial_index_insert(struct spatial_index *index, void *thing, int x, int y) {
+    struct spatial_entry e = { .thing = thing, .x = x, .y = y };
+    int id;
+    if (index->free_entry >= 0) {
+        id = index->free_entry;
+        index->free_entry = spatial_index_get(index, id)->slot;
+        index->entries.e[id] = e;
+    } else {
+        id = index->entries.length;
+        spatial_entry_vector_push(&index->entries, e);
+    }
+    link_entry(index, id);
+    return id;
+}
+
+void spatial_index_remove(struct spatial_index *index, int id) {
+    unlink_entry(index, id);
+    struct spatial_entry *e = spatial_index_get(index, id);
+    e->thing = NULL;
+    e->cell = -1;
+    e->slot = index->free_entry;
+    index->free_entry = id;
+}
+
+void spatial_index_move(struct spatial_index *index, int id, int x, int y) {
+    struct spatial_entry *e = spatial_index_get(index, id);
+    e->x = x;
+    e->y = y;
+    if (cell_of(index, x, y) != e->cell) {
+        unlink_entry(index, id);
+        link_entry(index, id);
+    }
+}
+
+// Call visit() with the id of everything within radius of (x, y). It
+// mustn't insert, remove or move anything.
+void spatial_index_visit(struct spatial_index *index, int x, int y, int radius, void (*visit)(void *context, int id), void *context) {
+    int first_column = clamp((x - radius) / index->cell_size, 0, index->columns - 1);
+    int last_column = clamp((x + radius) / index->cell_size, 0, index->columns - 1);
+    int first_row = clamp((y - radius) / index->cell_size, 0, index->rows - 1);
+    int last_row = clamp((y + radius) / index->cell_size, 0, index->rows - 1);
+
+    for (int row = first_row; row <= last_row; row++) {
+        for (int column = first_column; column <= last_column; column++) {
+            int_vector *cell = &index->cells[row * index->columns + column];
+            for (int i = 0; i < cell->length; i++) {
+                struct spatial_entry *e = spatial_index_get(index, cell->e[i]);
+                int dx = e->x - x;
+                int dy = e->y - y;
+                if (dx*dx + dy*dy <= radius*radius) visit(context, cell->e[i]);
+            }
+        }
+    }
+}
+
+static void push_id(void *ids, int id) {
+    int_vector_push((int_vector*)ids, id);
+}
+
+// Push the ids of everything within radius of (x, y) onto ids
+void spatial_index_within(struct spatial_index *index, int x, int y, int radius, int_vector *ids) {
+    spatial_index_visit(index, x, y, radius, push_id, (void*)ids);
+}
+
+// Push the ids of everything in the box from (x0, y0) to (x1, y1),
+// inclusive, onto ids
+void spatial_index_rect(struct spatial_index *index, int x0, int y0, int x1, int y1, int_vector *ids) {
+    if (x1 < x0 || y1 < y0) return;
+    int first_column = clamp(x0 / index->cell_size, 0, index->columns - 1);
+    int last_column = clamp(x1 / index->cell_size, 0, index->columns - 1);
+    int first_row = clamp(y0 / index->cell_size, 0, index->rows - 1);
+    int last_row = clamp(y1 / index->cell_size, 0, index->rows - 1);
+
+    for (int row = first_row; row <= last_row; row++) {
+        for (int column = first_column; column <= last_column; column++) {
+            int_vector *cell = &index->cells[row * index->columns + column];
+            for (int i = 0; i < cell->length; i++) {
+                struct spatial_entry *e = spatial_index_get(index, cell->e[i]);
+                if (x0 <= e->x && e->x <= x1 && y0 <= e->y && e->y <= y1) int_vector_push(ids, cell->e[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include "containers.h"
+
+// Things at positions, bucketed into square cells so that radius and
+// rectangle queries only look at the cells they overlap. Each cell keeps
+// the ids of its things in an array, so a query reads them straight off.
+struct spatial_entry {
+    void *thing;
+    int x;
+    int y;
+    // -1 once removed
+    int cell;
+    // Place in the cell's array, or the next free entry once removed
+    int slot;
+};
+
+VECTOR_DEFINE(spatial_entry_vector, struct spatial_entry)
+
+struct spatial_index {
+    int cell_size;
+    int columns;
+    int rows;
+    int_vector *cells;
+    spatial_entry_vector entries;
+    int free_entry;
+};
+
+struct spatial_index* make_spatial_index(int width, int height, int cell_size);
+void destroy_spatial_index(struct spatial_index *index);
+
+int spatial_index_insert(struct spatial_index *index, void *thing, int x, int y);
+void spatial_index_remove(struct spatial_index *index, int id);
+void spatial_index_move(struct spatial_index *index, int id, int x, int y);
+
+void spatial_index_visit(struct spatial_index *index, int x, int y, int radius, void (*visit)(void *context, int id), void *context);
+void spatial_index_within(struct spatial_index *index, int x, int y, int radius, int_vector *ids);
+void spatial_index_rect(struct spatial_index *index, int x0, int y0, int x1, int y1, int_vector *ids);
+
+static inline struct spatial_entry* spatial_index_get(struct spatial_index *index, int id) {
+    return &index->entries.e[id];
+}
+
+#endif
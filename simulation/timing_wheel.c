@@ -0,0 +1,333 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "timing_wheel.h"
+
+#define WHEEL_SPAN ((sim_clock)WHEEL_SLOTS * WHEEL_SLOTS)
+#define INSERTION_SORT_LIMIT 16
+
+// Where an entry with a given clock is filed, which only depends on the
+// clock and the slot being drained
+enum wheel_level {
+    CURRENT_LEVEL,
+    NEAR_LEVEL,
+    FAR_LEVEL,
+    OVERFLOW_LEVEL,
+    NEVER_LEVEL,
+};
+
+timing_wheel* make_timing_wheel(sim_clock slot_width) {
+    timing_wheel *w = calloc(1, sizeof(timing_wheel));
+    if (w == NULL) exit(1);
+    // Slots narrower than a tick make no sense and would divide by zero
+    if (slot_width < 1) slot_width = 1;
+    w->slot_width = slot_width;
+    w->current = 0;
+    w->cursor = 0;
+    w->sorted = false;
+    w->offset_counts = malloc(slot_width * sizeof(int));
+    if (w->offset_counts == NULL) exit(1);
+    return w;
+}
+
+void destroy_timing_wheel(timing_wheel *w) {
+    for (int i = 0; i < WHEEL_SLOTS; i++) {
+        free((void*)w->near[i].e);
+        free((void*)w->far[i].e);
+    }
+    free((void*)w->overflow.e);
+    free((void*)w->never.e);
+    free((void*)w->scratch.e);
+    free((void*)w->offset_counts);
+    free((void*)w);
+}
+
+static void slot_reserve(wheel_slot *slot) {
+    if (slot->length == slot->capacity) {
+        int capacity = slot->capacity == 0 ? 16 : slot->capacity * 2;
+        slot->e = realloc(slot->e, capacity * sizeof(wheel_entry));
+        if (slot->e == NULL) exit(1);
+        slot->capacity = capacity;
+    }
+}
+
+static void set_entry(wheel_slot *slot, int i, wheel_entry entry) {
+    slot->e[i] = entry;
+    entry.event->queue_index = i;
+}
+
+static void slot_append(wheel_slot *slot, wheel_entry entry) {
+    slot_reserve(slot);
+    set_entry(slot, slot->length++, entry);
+}
+
+static int compare_entries(const void *a, const void *b) {
+    sim_clock ca = ((wheel_entry*)a)->clock;
+    sim_clock cb = ((wheel_entry*)b)->clock;
+    return (ca > cb) - (ca < cb);
+}
+
+static wheel_slot* current_slot(timing_wheel *w) {
+    return &w->near[w->current & (WHEEL_SLOTS - 1)];
+}
+
+static enum wheel_level locate(timing_wheel *w, sim_clock clock, wheel_slot **slot) {
+    if (clock == CLOCK_NEVER) {
+        *slot = &w->never;
+        return NEVER_LEVEL;
+    }
+
+    sim_clock s = clock / w->slot_width;
+    if (s <= w->current) {
+        *slot = current_slot(w);
+        return CURRENT_LEVEL;
+    } else if (s / WHEEL_SLOTS == w->current / WHEEL_SLOTS) {
+        *slot = &w->near[s & (WHEEL_SLOTS - 1)];
+        return NEAR_LEVEL;
+    } else if (s / WHEEL_SPAN == w->current / WHEEL_SPAN) {
+        *slot = &w->far[(s / WHEEL_SLOTS) & (WHEEL_SLOTS - 1)];
+        return FAR_LEVEL;
+    } else {
+        *slot = &w->overflow;
+        return OVERFLOW_LEVEL;
+    }
+}
+
+// Order the undrained part of the current slot. Every clock in the slot is
+// an offset below slot_width from its start, so a counting sort does it in
+// linear time. Overdue entries fall outside that range and take the slow path.
+static void sort_current(timing_wheel *w) {
+    wheel_slot *slot = current_slot(w);
+    wheel_entry *e = &slot->e[w->cursor];
+    int n = slot->length - w->cursor;
+    sim_clock start = w->current * w->slot_width;
+    bool overdue = false;
+
+    for (int i = 0; i < n; i++) {
+        if (e[i].clock < start) overdue = true;
+    }
+
+    if (n <= INSERTION_SORT_LIMIT) {
+        for (int i = 1; i < n; i++) {
+            wheel_entry entry = e[i];
+            int j = i;
+            while (j > 0 && e[j-1].clock > entry.clock) {
+                e[j] = e[j-1];
+                j--;
+            }
+            e[j] = entry;
+        }
+    } else if (overdue) {
+        qsort(e, n, sizeof(wheel_entry), compare_entries);
+    } else {
+        if (w->scratch.capacity < n) {
+            w->scratch.e = realloc(w->scratch.e, n * sizeof(wheel_entry));
+            if (w->scratch.e == NULL) exit(1);
+            w->scratch.capacity = n;
+        }
+        memset(w->offset_counts, 0, w->slot_width * sizeof(int));
+        for (int i = 0; i < n; i++) w->offset_counts[e[i].clock - start]++;
+        int total = 0;
+        for (sim_clock k = 0; k < w->slot_width; k++) {
+            int count = w->offset_counts[k];
+            w->offset_counts[k] = total;
+            total += count;
+        }
+        for (int i = 0; i < n; i++) w->scratch.e[w->offset_counts[e[i].clock - start]++] = e[i];
+        memcpy(e, w->scratch.e, n * sizeof(wheel_entry));
+    }
+
+    for (int i = w->cursor; i < slot->length; i++) slot->e[i].event->queue_index = i;
+}
+
+// Entries due in the slot being drained (or overdue) go straight into it.
+// Once the slot is sorted they are inserted in order after the cursor.
+static void insert_current(timing_wheel *w, wheel_entry entry) {
+    wheel_slot *slot = current_slot(w);
+    slot_reserve(slot);
+
+    int i = slot->length;
+    if (w->sorted) {
+        int lo = w->cursor;
+        int hi = slot->length;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (slot->e[mid].clock <= entry.clock) lo = mid + 1;
+            else hi = mid;
+        }
+        i = lo;
+        for (int j = slot->length; j > i; j--) set_entry(slot, j, slot->e[j-1]);
+    }
+    set_entry(slot, i, entry);
+    slot->length++;
+    w->near_count++;
+}
+
+static void place(timing_wheel *w, wheel_entry entry) {
+    wheel_slot *slot;
+    entry.event->clock = entry.clock;
+
+    switch (locate(w, entry.clock, &slot)) {
+        case CURRENT_LEVEL:
+            insert_current(w, entry);
+            break;
+        case NEAR_LEVEL:
+            slot_append(slot, entry);
+            w->near_count++;
+            break;
+        case FAR_LEVEL:
+            slot_append(slot, entry);
+            w->far_count++;
+            break;
+        case OVERFLOW_LEVEL:
+        case NEVER_LEVEL:
+            slot_append(slot, entry);
+            break;
+    }
+}
+
+// Take entry i out of a slot where order doesn't matter
+static void slot_remove(wheel_slot *slot, int i) {
+    slot->length--;
+    if (i < slot->length) set_entry(slot, i, slot->e[slot->length]);
+}
+
+// Move every overflow entry that falls in the current span down a level
+static void pull_overflow(timing_wheel *w) {
+    int i = 0;
+    while (i < w->overflow.length) {
+        wheel_entry entry = w->overflow.e[i];
+        if (entry.clock / w->slot_width / WHEEL_SPAN == w->current / WHEEL_SPAN) {
+            slot_remove(&w->overflow, i);
+            place(w, entry);
+        } else {
+            i++;
+        }
+    }
+}
+
+static void cascade(timing_wheel *w) {
+    wheel_slot *slot = &w->far[(w->current / WHEEL_SLOTS) & (WHEEL_SLOTS - 1)];
+    w->far_count -= slot->length;
+    for (int i = 0; i < slot->length; i++) {
+        place(w, slot->e[i]);
+    }
+    slot->length = 0;
+}
+
+static void advance(timing_wheel *w) {
+    current_slot(w)->length = 0;
+    w->cursor = 0;
+    w->sorted = false;
+
+    if (w->near_count > 0) {
+        w->current++;
+        return;
+    }
+
+    // Nothing left in this block, skip ahead to the next one with entries
+    while (w->near_count == 0 && w->far_count + w->overflow.length > 0) {
+        if (w->far_count == 0) {
+            sim_clock earliest = CLOCK_NEVER;
+            for (int i = 0; i < w->overflow.length; i++) {
+                if (w->overflow.e[i].clock < earliest) earliest = w->overflow.e[i].clock;
+            }
+            w->current = earliest / w->slot_width / WHEEL_SPAN * WHEEL_SPAN;
+            pull_overflow(w);
+        } else {
+            w->current = (w->current / WHEEL_SLOTS + 1) * WHEEL_SLOTS;
+        }
+        cascade(w);
+    }
+}
+
+// Leave the cursor on the earliest timed entry, returning false if there
+// isn't one
+static bool settle(timing_wheel *w) {
+    while (w->near_count + w->far_count + w->overflow.length > 0) {
+        wheel_slot *slot = current_slot(w);
+        if (w->cursor < slot->length) {
+            if (!w->sorted) {
+                sort_current(w);
+                w->sorted = true;
+            }
+            return true;
+        }
+        advance(w);
+    }
+    return false;
+}
+
+void timing_wheel_push(timing_wheel *w, struct event *event, sim_clock clock) {
+    wheel_entry entry;
+    entry.clock = clock;
+    entry.event = event;
+    place(w, entry);
+    w->length++;
+}
+
+void timing_wheel_peek(timing_wheel *w, struct event **event, sim_clock *clock) {
+    if (settle(w)) {
+        wheel_entry *entry = &current_slot(w)->e[w->cursor];
+        *event = entry->event;
+        *clock = entry->clock;
+    } else if (w->never.length > 0) {
+        *event = w->never.e[w->never.length - 1].event;
+        *clock = CLOCK_NEVER;
+    } else {
+        *event = NULL;
+        *clock = CLOCK_NEVER;
+    }
+}
+
+void timing_wheel_pop(timing_wheel *w, struct event **event, sim_clock *clock) {
+    timing_wheel_peek(w, event, clock);
+    if (w->length == 0) return;
+
+    if (*clock == CLOCK_NEVER) {
+        w->never.length--;
+    } else {
+        w->cursor++;
+        w->near_count--;
+    }
+    (*event)->queue_index = -1;
+    w->length--;
+}
+
+void timing_wheel_remove(timing_wheel *w, struct event *event) {
+    wheel_slot *slot;
+    int i = event->queue_index;
+
+    switch (locate(w, event->clock, &slot)) {
+        case CURRENT_LEVEL:
+            if (w->sorted) {
+                // Keep the slot being drained in order
+                for (int j = i; j < slot->length - 1; j++) set_entry(slot, j, slot->e[j+1]);
+                slot->length--;
+            } else {
+                slot_remove(slot, i);
+            }
+            w->near_count--;
+            break;
+        case NEAR_LEVEL:
+            slot_remove(slot, i);
+            w->near_count--;
+            break;
+        case FAR_LEVEL:
+            slot_remove(slot, i);
+            w->far_count--;
+            break;
+        case OVERFLOW_LEVEL:
+        case NEVER_LEVEL:
+            slot_remove(slot, i);
+            break;
+    }
+    event->queue_index = -1;
+    w->length--;
+}
+
+// Refile a queued event, O(1) unless either clock is in the slot being drained
+void timing_wheel_update(timing_wheel *w, struct event *event, sim_clock clock) {
+    timing_wheel_remove(w, event);
+    timing_wheel_push(w, event, clock);
+}
@@ -0,0 +1,51 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <stdbool.h>
+
+#include "event.h"
+
+// Slots per level, must be a power of two. The near level covers
+// WHEEL_SLOTS slots of slot_width ticks, the far level WHEEL_SLOTS blocks of
+// WHEEL_SLOTS slots, and anything later waits in the overflow list.
+#define WHEEL_SLOTS 64
+
+typedef struct {
+    sim_clock clock;
+    struct event *event;
+} wheel_entry;
+
+typedef struct {
+    wheel_entry *e;
+    int length;
+    int capacity;
+} wheel_slot;
+
+typedef struct {
+    sim_clock slot_width;
+    // Absolute index of the near slot being drained, and how far into it
+    sim_clock current;
+    int cursor;
+    bool sorted;
+    wheel_slot near[WHEEL_SLOTS];
+    wheel_slot far[WHEEL_SLOTS];
+    wheel_slot overflow;
+    // CLOCK_NEVER entries, which only leave when the caller cancels them
+    wheel_slot never;
+    // Scratch space for ordering a slot when it comes up
+    wheel_slot scratch;
+    int *offset_counts;
+    int near_count;
+    int far_count;
+    int length;
+} timing_wheel;
+
+timing_wheel* make_timing_wheel(sim_clock slot_width);
+void destroy_timing_wheel(timing_wheel *w);
+void timing_wheel_push(timing_wheel *w, struct event *event, sim_clock clock);
+void timing_wheel_pop(timing_wheel *w, struct event **event, sim_clock *clock);
+void timing_wheel_peek(timing_wheel *w, struct event **event, sim_clock *clock);
+void timing_wheel_update(timing_wheel *w, struct event *event, sim_clock clock);
+void timing_wheel_remove(timing_wheel *w, struct event *event);
+
+#endif
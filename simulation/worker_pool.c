@@ -0,0 +1,101 @@
+#include <stdlib.h>
+
+#include "worker_pool.h"
+
+// Indices handed out per grab, enough to keep the shared counter cool
+#define WORKER_CHUNK 16
+
+static void run_tasks(struct worker_pool *pool) {
+    int i;
+    while ((i = atomic_fetch_add(&pool->next, WORKER_CHUNK)) < pool->count) {
+        int end = i + WORKER_CHUNK;
+        if (end > pool->count) end = pool->count;
+        for (; i < end; i++) pool->task(pool->context, i);
+    }
+}
+
+static void* worker_main(void *vpool) {
+    struct worker_pool *pool = (struct worker_pool*)vpool;
+    unsigned int seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (pool->generation == seen && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_tasks(pool);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->busy--;
+        if (pool->busy == 0) pthread_cond_signal(&pool->work_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+struct worker_pool* make_worker_pool(int thread_count) {
+    struct worker_pool *pool = malloc(sizeof(struct worker_pool));
+    if (thread_count < 1) thread_count = 1;
+    pool->thread_count = thread_count;
+    pool->threads = malloc(thread_count * sizeof(pthread_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    pool->task = NULL;
+    pool->context = NULL;
+    pool->count = 0;
+    atomic_init(&pool->next, 0);
+    pool->busy = 0;
+    pool->generation = 0;
+    pool->shutdown = false;
+
+    for (int i = 1; i < thread_count; i++) {
+        pthread_create(&pool->threads[i], NULL, worker_main, (void*)pool);
+    }
+    return pool;
+}
+
+void destroy_worker_pool(struct worker_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free((void*)pool->threads);
+    free((void*)pool);
+}
+
+// Call task(context, i) for every i below count, spread over the pool, and
+// return once all of them have finished. A NULL pool runs them all here.
+void worker_pool_run(struct worker_pool *pool, void (*task)(void *context, int index), void *context, int count) {
+    if (pool == NULL || pool->thread_count == 1 || count <= WORKER_CHUNK) {
+        for (int i = 0; i < count; i++) task(context, i);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->count = count;
+    atomic_store(&pool->next, 0);
+    pool->busy = pool->thread_count - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_tasks(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) pthread_cond_wait(&pool->work_done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
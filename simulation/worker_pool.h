@@ -0,0 +1,29 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// A fixed set of threads that run one indexed job at a time. The calling
+// thread works on the job too, so a pool of one has no helper threads.
+struct worker_pool {
+    int thread_count;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    void (*task)(void *context, int index);
+    void *context;
+    int count;
+    atomic_int next;
+    int busy;
+    unsigned int generation;
+    bool shutdown;
+};
+
+struct worker_pool* make_worker_pool(int thread_count);
+void destroy_worker_pool(struct worker_pool *pool);
+void worker_pool_run(struct worker_pool *pool, void (*task)(void *context, int index), void *context, int count);
+
+#endif
@@ -9,9 +9,20 @@ int main(void)
     SRunner *sr;
 
     sr = srunner_create(make_mheap_suite());
+    srunner_add_suite(sr, make_event_queue_suite());
+    srunner_add_suite(sr, make_timing_wheel_suite());
     srunner_add_suite(sr, make_vector_suite());
     srunner_add_suite(sr, make_simulation_suite());
+    srunner_add_suite(sr, make_coroutine_suite());
+    srunner_add_suite(sr, make_sensory_bus_suite());
+    srunner_add_suite(sr, make_spatial_index_suite());
     srunner_add_suite(sr, make_chemistry_suite());
+    srunner_add_suite(sr, make_fov_suite());
+    srunner_add_suite(sr, make_los_suite());
+    srunner_add_suite(sr, make_distance_map_suite());
+    srunner_add_suite(sr, make_room_graph_suite());
+    srunner_add_suite(sr, make_regions_suite());
+    srunner_add_suite(sr, make_level_suite());
 
     srunner_run_all(sr, CK_NORMAL);
     number_failed = srunner_ntests_failed(sr);
@@ -2,9 +2,20 @@
 #define CHECK_CHECK_H
 
 Suite *make_mheap_suite(void);
+Suite *make_event_queue_suite(void);
+Suite *make_timing_wheel_suite(void);
 Suite *make_vector_suite(void);
 Suite *make_simulation_suite(void);
+Suite *make_coroutine_suite(void);
+Suite *make_sensory_bus_suite(void);
+Suite *make_spatial_index_suite(void);
 Suite *make_chemistry_suite(void);
+Suite *make_fov_suite(void);
+Suite *make_los_suite(void);
+Suite *make_distance_map_suite(void);
+Suite *make_room_graph_suite(void);
+Suite *make_regions_suite(void);
+Suite *make_level_suite(void);
 
 #define FIXED_SEED 123456
 
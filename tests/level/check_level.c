@@ -0,0 +1,152 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../level/level.h"
+#include "../../mob/mob.h"
+#include "../../simulation/spatial_index.h"
+
+static level *lvl;
+
+void level_setup(void) {
+    // make_level() names the player after the user
+    setenv("USER", "tester", 0);
+    lvl = make_level(5);
+};
+
+void level_teardown(void) {
+    destroy_level(lvl);
+};
+
+static mobile* first_mob(void) {
+    for (int i = 0; i < lvl->mob_count; i++) {
+        if (lvl->mobs[i] != lvl->player && lvl->mobs[i]->active) return lvl->mobs[i];
+    }
+    return NULL;
+}
+
+// The delay the level's LOD policy gives mob when it asks for delay from
+// distance tiles away from the player
+static int delay_at(mobile *mob, int distance, int delay) {
+    int x = mob->x, y = mob->y;
+    int player_x = lvl->player->x, player_y = lvl->player->y;
+    lvl->player->x = 0;
+    lvl->player->y = 0;
+    mob->x = distance;
+    mob->y = 0;
+    int stretched = lvl->sim->lod(lvl->sim->context, (void*)mob, delay);
+    mob->x = x;
+    mob->y = y;
+    lvl->player->x = player_x;
+    lvl->player->y = player_y;
+    return stretched;
+}
+
+START_TEST(lod_stretches_only_wandering) {
+    mobile *mob = first_mob();
+    ck_assert_ptr_ne(mob, NULL);
+    mob->alert = 0;
+    mob->sees_player = false;
+
+    ck_assert_int_eq(delay_at(mob, 1, TICKS_PER_TURN), TICKS_PER_TURN);
+    ck_assert_int_gt(delay_at(mob, lvl->width - 1, TICKS_PER_TURN), TICKS_PER_TURN);
+    ck_assert_int_gt(mob->lod_steps, 1);
+} END_TEST
+
+START_TEST(lod_leaves_chasers_at_full_rate) {
+    mobile *mob = first_mob();
+    ck_assert_ptr_ne(mob, NULL);
+    mob->alert = 0;
+
+    // Charging at the player in sight
+    mob->sees_player = true;
+    for (int distance = 0; distance < lvl->width; distance++) {
+        ck_assert_int_eq(delay_at(mob, distance, TICKS_PER_TURN), TICKS_PER_TURN);
+        ck_assert_int_eq(mob->lod_steps, 1);
+    }
+
+    // Making for where it last saw the player
+    mob->sees_player = false;
+    int_vector_push(&mob->route, 0);
+    for (int distance = 0; distance < lvl->width; distance++) {
+        ck_assert_int_eq(delay_at(mob, distance, TICKS_PER_TURN), TICKS_PER_TURN);
+        ck_assert_int_eq(mob->lod_steps, 1);
+    }
+    int_vector_clear(&mob->route);
+} END_TEST
+
+// VISION_CHANGE handler counting what the watched mob is told, by which
+// way its view flipped
+static mobile *watched;
+static int vision_changes[2];
+
+static bool count_vision_change(void *state) {
+    mobile *mob = (mobile*)state;
+    if (mob == watched) vision_changes[mob->sees_player]++;
+    return false;
+}
+
+static void place(mobile *mob, int x, int y) {
+    mob->x = x;
+    mob->y = y;
+    if (mob->place >= 0) spatial_index_move(lvl->mob_index, mob->place, x, y);
+}
+
+START_TEST(vision_change_sent_once_each_way) {
+    // An open map split by a wall with a one tile gap, the player on one
+    // side looking through the gap and the mob walking past it on the
+    // far side of the map
+    int gap_y = lvl->height / 2;
+    int wall_x = lvl->width / 2;
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            bool edge = x == 0 || y == 0 || x == lvl->width - 1 || y == lvl->height - 1;
+            lvl->tiles[x][y] = edge || (x == wall_x && y != gap_y) ? TILE_WALL : TILE_FLOOR;
+            level_terrain_changed(lvl, x, y);
+        }
+    }
+    place(lvl->player, lvl->width / 4, gap_y);
+
+    watched = first_mob();
+    ck_assert_ptr_ne(watched, NULL);
+    ((item*)watched)->listeners[VISION_CHANGE].handler = count_vision_change;
+    int walk_x = lvl->width - 3;
+    place(watched, walk_x, 1);
+    level_update_vision(lvl);
+    ck_assert(!watched->sees_player);
+
+    vision_changes[false] = vision_changes[true] = 0;
+    bool saw = false;
+    for (int y = 1; y < lvl->height - 1; y++) {
+        place(watched, walk_x, y);
+        level_update_vision(lvl);
+        ck_assert_int_eq(watched->sees_player, lvl->visible[walk_x][y]);
+        saw |= watched->sees_player;
+    }
+    ck_assert(saw);
+    ck_assert(!watched->sees_player);
+    ck_assert_int_eq(vision_changes[true], 1);
+    ck_assert_int_eq(vision_changes[false], 1);
+    ((item*)watched)->listeners[VISION_CHANGE].handler = NULL;
+} END_TEST
+
+Suite * make_level_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Level");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, level_setup, level_teardown);
+    tcase_add_test(tc_core, lod_stretches_only_wandering);
+    tcase_add_test(tc_core, lod_leaves_chasers_at_full_rate);
+    tcase_add_test(tc_core, vision_change_sent_once_each_way);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
@@ -0,0 +1,277 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../level/level.h"
+#include "../../los/fov.h"
+#include "../../simulation/worker_pool.h"
+
+#define FOV_MAPS 10
+#define FOV_ORIGINS 40
+#define FOV_PILLARS 150
+#define FOV_VIEWERS 64
+#define FOV_POOL_THREADS 4
+// Short of the map, so sight gets cut off by the radius as well as walls
+#define FOV_RADIUS 20
+
+static bool cells[FOV_ORIGINS][MAX_MAP_WIDTH][MAX_MAP_HEIGHT];
+static bool *columns[FOV_ORIGINS][MAX_MAP_WIDTH];
+
+void fov_setup(void) {
+    // make_level() names the player after the user
+    setenv("USER", "tester", 0);
+    for (int i = 0; i < FOV_ORIGINS; i++) {
+        for (int x = 0; x < MAX_MAP_WIDTH; x++) columns[i][x] = cells[i][x];
+    }
+};
+
+void fov_teardown(void) {
+};
+
+static bool blocks(level *lvl, int x, int y) {
+    return lvl->tiles[x][y] == TILE_WALL || lvl->tiles[x][y] == DOOR_CLOSED;
+}
+
+// A generated map with its doors open, so sight runs between rooms, and
+// some pillars scattered about for it to go around
+static level* open_map(long seed) {
+    level *lvl = make_level(seed);
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            if (lvl->tiles[x][y] == DOOR_CLOSED) {
+                lvl->tiles[x][y] = DOOR_OPEN;
+                level_terrain_changed(lvl, x, y);
+            }
+        }
+    }
+    srand(FIXED_SEED + seed);
+    for (int i = 0; i < FOV_PILLARS; i++) {
+        int x = 1 + rand() % (lvl->width - 2);
+        int y = 1 + rand() % (lvl->height - 2);
+        if (lvl->tiles[x][y] != TILE_FLOOR || (x == lvl->player->x && y == lvl->player->y)) continue;
+        lvl->tiles[x][y] = TILE_WALL;
+        level_terrain_changed(lvl, x, y);
+    }
+    return lvl;
+}
+
+static void check_symmetric(int radius) {
+    for (long seed = 1; seed <= FOV_MAPS; seed++) {
+        level *lvl = open_map(seed);
+        int xs[FOV_ORIGINS], ys[FOV_ORIGINS];
+        for (int i = 0; i < FOV_ORIGINS; i++) {
+            do {
+                xs[i] = rand() % lvl->width;
+                ys[i] = rand() % lvl->height;
+            } while (blocks(lvl, xs[i], ys[i]));
+            compute_fov(lvl, xs[i], ys[i], radius, FOV_SYMMETRIC, columns[i]);
+        }
+
+        for (int i = 0; i < FOV_ORIGINS; i++) {
+            for (int j = 0; j < FOV_ORIGINS; j++) {
+                ck_assert_int_eq(cells[i][xs[j]][ys[j]], cells[j][xs[i]][ys[i]]);
+            }
+        }
+        destroy_level(lvl);
+    }
+}
+
+START_TEST(symmetric_fov_is_symmetric) {
+    check_symmetric(FOV_RADIUS);
+    check_symmetric(PLAYER_SIGHT_RADIUS);
+} END_TEST
+
+START_TEST(fov_sees_through_open_doors_only) {
+    level *lvl = make_level(5);
+    int door_x = -1, door_y = -1;
+    for (int x = 1; x < lvl->width - 1 && door_x < 0; x++) {
+        for (int y = 1; y < lvl->height - 1; y++) {
+            if (lvl->tiles[x][y] == DOOR_CLOSED && !blocks(lvl, x-1, y) && !blocks(lvl, x+1, y)) {
+                door_x = x;
+                door_y = y;
+                break;
+            }
+        }
+    }
+    ck_assert_int_ge(door_x, 0);
+
+    // From one side of the door, the tile on the other side
+    compute_fov(lvl, door_x - 1, door_y, FOV_RADIUS, FOV_SYMMETRIC, columns[0]);
+    ck_assert(cells[0][door_x][door_y]);
+    ck_assert(!cells[0][door_x + 1][door_y]);
+
+    lvl->tiles[door_x][door_y] = DOOR_OPEN;
+    level_terrain_changed(lvl, door_x, door_y);
+    compute_fov(lvl, door_x - 1, door_y, FOV_RADIUS, FOV_SYMMETRIC, columns[0]);
+    ck_assert(cells[0][door_x + 1][door_y]);
+    destroy_level(lvl);
+} END_TEST
+
+// An empty walled room with the origin in the middle, so what the origin
+// sees is only down to the radius and whatever is put in its way
+static level* empty_room(int *origin_x, int *origin_y) {
+    level *lvl = make_level(1);
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            bool edge = x == 0 || y == 0 || x == lvl->width - 1 || y == lvl->height - 1;
+            lvl->tiles[x][y] = edge ? TILE_WALL : TILE_FLOOR;
+            level_terrain_changed(lvl, x, y);
+        }
+    }
+    *origin_x = lvl->width / 2;
+    *origin_y = lvl->height / 2;
+    return lvl;
+}
+
+static void check_open_room(enum fov_mode mode) {
+    int ox, oy, radius = 6;
+    level *lvl = empty_room(&ox, &oy);
+    compute_fov(lvl, ox, oy, radius, mode, columns[0]);
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            int dx = x - ox, dy = y - oy;
+            ck_assert_int_eq(cells[0][x][y], dx*dx + dy*dy <= radius*radius);
+        }
+    }
+    destroy_level(lvl);
+}
+
+// A wall or closed door two tiles east is seen, and shades the row behind it
+static void check_blocker(enum fov_mode mode, chtype blocker) {
+    int ox, oy, radius = 6;
+    level *lvl = empty_room(&ox, &oy);
+    lvl->tiles[ox + 2][oy] = blocker;
+    level_terrain_changed(lvl, ox + 2, oy);
+    compute_fov(lvl, ox, oy, radius, mode, columns[0]);
+    ck_assert(cells[0][ox + 1][oy]);
+    ck_assert(cells[0][ox + 2][oy]);
+    for (int x = ox + 3; x <= ox + radius; x++) ck_assert(!cells[0][x][oy]);
+    // The other sides are untouched
+    ck_assert(cells[0][ox - radius][oy]);
+    ck_assert(cells[0][ox][oy - radius]);
+    ck_assert(cells[0][ox][oy + radius]);
+    destroy_level(lvl);
+}
+
+START_TEST(fov_sees_open_floor_within_radius) {
+    check_open_room(FOV_SHADOWCAST);
+    check_open_room(FOV_SYMMETRIC);
+} END_TEST
+
+START_TEST(fov_stops_at_walls_and_closed_doors) {
+    check_blocker(FOV_SHADOWCAST, TILE_WALL);
+    check_blocker(FOV_SHADOWCAST, DOOR_CLOSED);
+    check_blocker(FOV_SYMMETRIC, TILE_WALL);
+    check_blocker(FOV_SYMMETRIC, DOOR_CLOSED);
+} END_TEST
+
+// Whether a viewer's bits agree with compute_fov() from the same spot,
+// nothing outside its box included
+static void check_viewer(level *lvl, struct viewer_fov *fov, int radius) {
+    compute_fov(lvl, fov->x, fov->y, radius, FOV_SYMMETRIC, columns[0]);
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            ck_assert_int_eq(viewer_fov_sees(fov, x, y), cells[0][x][y]);
+        }
+    }
+}
+
+START_TEST(compute_fovs_matches_compute_fov) {
+    struct worker_pool *pool = make_worker_pool(FOV_POOL_THREADS);
+    struct viewer_fov serial[FOV_VIEWERS], pooled[FOV_VIEWERS];
+    struct viewer_fov *serial_viewers[FOV_VIEWERS], *pooled_viewers[FOV_VIEWERS];
+    int xs[FOV_VIEWERS], ys[FOV_VIEWERS];
+    for (int i = 0; i < FOV_VIEWERS; i++) {
+        init_viewer_fov(&serial[i]);
+        init_viewer_fov(&pooled[i]);
+        serial_viewers[i] = &serial[i];
+        pooled_viewers[i] = &pooled[i];
+    }
+
+    for (long seed = 5; seed <= 9; seed++) {
+        level *lvl = open_map(seed);
+        for (int i = 0; i < FOV_VIEWERS; i++) {
+            do {
+                xs[i] = rand() % lvl->width;
+                ys[i] = rand() % lvl->height;
+            } while (blocks(lvl, xs[i], ys[i]));
+        }
+        compute_fovs(lvl, NULL, serial_viewers, xs, ys, FOV_VIEWERS, FOV_RADIUS, FOV_SYMMETRIC);
+        compute_fovs(lvl, pool, pooled_viewers, xs, ys, FOV_VIEWERS, FOV_RADIUS, FOV_SYMMETRIC);
+        for (int i = 0; i < FOV_VIEWERS; i++) {
+            check_viewer(lvl, &serial[i], FOV_RADIUS);
+            check_viewer(lvl, &pooled[i], FOV_RADIUS);
+        }
+        destroy_level(lvl);
+    }
+
+    for (int i = 0; i < FOV_VIEWERS; i++) {
+        free_viewer_fov(&serial[i]);
+        free_viewer_fov(&pooled[i]);
+    }
+    destroy_worker_pool(pool);
+} END_TEST
+
+// An unmoved viewer keeps its bits through edits outside its box, and has
+// them worked out again after one inside. A bit flipped by hand shows
+// which happened.
+START_TEST(compute_fovs_recomputes_only_stale_viewers) {
+    const int radius = 8;
+    level *lvl = open_map(5);
+    struct viewer_fov fov;
+    struct viewer_fov *viewers[1] = { &fov };
+    init_viewer_fov(&fov);
+
+    int x, y;
+    do {
+        x = rand() % (lvl->width / 4);
+        y = rand() % lvl->height;
+    } while (blocks(lvl, x, y));
+    compute_fovs(lvl, NULL, viewers, &x, &y, 1, radius, FOV_SYMMETRIC);
+    check_viewer(lvl, &fov, radius);
+    bool corner = viewer_fov_sees(&fov, fov.x0, fov.y0);
+    fov.bits[0] ^= 1;
+
+    // Far off to the east, well clear of the box
+    int far_x = lvl->width - 2;
+    int far_y = lvl->height / 2;
+    int tile = lvl->tiles[far_x][far_y];
+    lvl->tiles[far_x][far_y] = TILE_WALL;
+    level_terrain_changed(lvl, far_x, far_y);
+    compute_fovs(lvl, NULL, viewers, &x, &y, 1, radius, FOV_SYMMETRIC);
+    ck_assert_int_ne(viewer_fov_sees(&fov, fov.x0, fov.y0), corner);
+
+    // The viewer's own tile, inside the box
+    lvl->tiles[far_x][far_y] = tile;
+    level_terrain_changed(lvl, far_x, far_y);
+    level_terrain_changed(lvl, x, y);
+    compute_fovs(lvl, NULL, viewers, &x, &y, 1, radius, FOV_SYMMETRIC);
+    check_viewer(lvl, &fov, radius);
+
+    free_viewer_fov(&fov);
+    destroy_level(lvl);
+} END_TEST
+
+Suite * make_fov_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Field of View");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, fov_setup, fov_teardown);
+    tcase_add_test(tc_core, symmetric_fov_is_symmetric);
+    tcase_add_test(tc_core, fov_sees_through_open_doors_only);
+    tcase_add_test(tc_core, fov_sees_open_floor_within_radius);
+    tcase_add_test(tc_core, fov_stops_at_walls_and_closed_doors);
+    tcase_add_test(tc_core, compute_fovs_matches_compute_fov);
+    tcase_add_test(tc_core, compute_fovs_recomputes_only_stale_viewers);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
@@ -0,0 +1,271 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../level/level.h"
+#include "../../los/los.h"
+
+#define LOS_MAPS 10
+#define LOS_ROUNDS 100
+#define LOS_QUERIES 100
+#define LOS_LONG_LINES 2000
+
+// The cells a line crosses between its ends, as check_line() stepped them
+static int line_xs[MAX_MAP_WIDTH + MAX_MAP_HEIGHT];
+static int line_ys[MAX_MAP_WIDTH + MAX_MAP_HEIGHT];
+
+void los_setup(void) {
+    // make_level() names the player after the user
+    setenv("USER", "tester", 0);
+};
+
+void los_teardown(void) {
+};
+
+static void set_tile(level *lvl, int x, int y, int tile) {
+    lvl->tiles[x][y] = tile;
+    level_terrain_changed(lvl, x, y);
+}
+
+// Whether the line is clear, walked afresh without the cache
+static bool uncached(level *lvl, int x0, int y0, int x1, int y1) {
+    int bx, by;
+    return !line_first_blocker(lvl, x0, y0, x1, y1, &bx, &by);
+}
+
+// A door with floor either side of it along X, which a line across it
+// has to pass through
+static bool find_door(level *lvl, int *x, int *y) {
+    for (int dx = 1; dx < lvl->width - 1; dx++) {
+        for (int dy = 1; dy < lvl->height - 1; dy++) {
+            if (lvl->tiles[dx][dy] != DOOR_CLOSED) continue;
+            if (is_opaque(lvl, dx - 1, dy) || is_opaque(lvl, dx + 1, dy)) continue;
+            *x = dx;
+            *y = dy;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Wall off and restore a floor tile well away from (x, y), two edits
+static void edit_elsewhere(level *lvl, int x, int y) {
+    int far_x = x < lvl->width / 2 ? lvl->width - 2 : 1;
+    int far_y = y < lvl->height / 2 ? lvl->height - 2 : 1;
+    int tile = lvl->tiles[far_x][far_y];
+    set_tile(lvl, far_x, far_y, TILE_WALL);
+    set_tile(lvl, far_x, far_y, tile);
+}
+
+// Bresenham's line as the original check_line() stepped it, straight lines
+// and 45 degrees (stepped along Y) included. Returns how many cells lie
+// strictly between the two ends.
+static int step_line(int x0, int y0, int x1, int y1) {
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    int x_step = x1 >= x0 ? 1 : -1;
+    int y_step = y1 >= y0 ? 1 : -1;
+    bool shallow = dx > dy;
+    int run = shallow ? dx : dy;
+    int rise = shallow ? dy : dx;
+    int debt = 0;
+    int x = x0, y = y0, count = 0;
+
+    while (true) {
+        if (shallow) {
+            x += x_step;
+        } else {
+            y += y_step;
+        }
+        debt += rise;
+        if (debt >= run) {
+            if (shallow) {
+                y += y_step;
+            } else {
+                x += x_step;
+            }
+            debt -= run;
+        }
+        if (x == x1 && y == y1) return count;
+        line_xs[count] = x;
+        line_ys[count] = y;
+        count++;
+    }
+}
+
+static void fill(level *lvl, int tile) {
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) lvl->tiles[x][y] = tile;
+    }
+}
+
+// line_first_blocker() crosses exactly the cells step_line() does: walled
+// off everywhere else the line is clear, and a wall on any one of those
+// cells is the blocker it reports, even with another further along
+static void check_line_cells(level *lvl, int x0, int y0, int x1, int y1) {
+    int count = step_line(x0, y0, x1, y1);
+    int bx, by;
+
+    fill(lvl, TILE_WALL);
+    lvl->tiles[x0][y0] = TILE_FLOOR;
+    lvl->tiles[x1][y1] = TILE_FLOOR;
+    for (int i = 0; i < count; i++) lvl->tiles[line_xs[i]][line_ys[i]] = TILE_FLOOR;
+    ck_assert(!line_first_blocker(lvl, x0, y0, x1, y1, &bx, &by));
+
+    for (int i = 0; i < count; i++) {
+        lvl->tiles[line_xs[i]][line_ys[i]] = TILE_WALL;
+        lvl->tiles[line_xs[count - 1]][line_ys[count - 1]] = DOOR_CLOSED;
+        ck_assert(line_first_blocker(lvl, x0, y0, x1, y1, &bx, &by));
+        ck_assert_int_eq(bx, line_xs[i]);
+        ck_assert_int_eq(by, line_ys[i]);
+        lvl->tiles[line_xs[i]][line_ys[i]] = TILE_FLOOR;
+        lvl->tiles[line_xs[count - 1]][line_ys[count - 1]] = TILE_FLOOR;
+    }
+}
+
+START_TEST(ray_table_walks_bresenham_lines) {
+    level *lvl = make_level(5);
+    for (int dx = -LOS_RAY_RADIUS; dx <= LOS_RAY_RADIUS; dx++) {
+        for (int dy = -LOS_RAY_RADIUS; dy <= LOS_RAY_RADIUS; dy++) {
+            if (dx == 0 && dy == 0) continue;
+            // From the corner that keeps the far end on the map
+            int x0 = dx >= 0 ? 0 : lvl->width - 1;
+            int y0 = dy >= 0 ? 0 : lvl->height - 1;
+            check_line_cells(lvl, x0, y0, x0 + dx, y0 + dy);
+        }
+    }
+    destroy_level(lvl);
+} END_TEST
+
+START_TEST(long_lines_walk_bresenham_lines) {
+    level *lvl = make_level(5);
+    srand(FIXED_SEED);
+    for (int i = 0; i < LOS_LONG_LINES; i++) {
+        int x0, y0, x1, y1;
+        do {
+            x0 = rand() % lvl->width;
+            y0 = rand() % lvl->height;
+            x1 = rand() % lvl->width;
+            y1 = rand() % lvl->height;
+        } while (abs(x1 - x0) <= LOS_RAY_RADIUS && abs(y1 - y0) <= LOS_RAY_RADIUS);
+        check_line_cells(lvl, x0, y0, x1, y1);
+    }
+    destroy_level(lvl);
+} END_TEST
+
+START_TEST(cached_line_outlasts_edits_elsewhere) {
+    level *lvl = make_level(5);
+    struct los_cache *cache = lvl->sight_cache;
+    int x, y;
+    ck_assert(find_door(lvl, &x, &y));
+
+    ck_assert(!line_of_sight(lvl, x - 1, y, x + 1, y));
+    long misses = cache->misses;
+    long hits = cache->hits;
+    for (int i = 0; i < TERRAIN_EDIT_LOG / 4; i++) edit_elsewhere(lvl, x, y);
+    ck_assert(!line_of_sight(lvl, x - 1, y, x + 1, y));
+    ck_assert_int_eq(cache->misses, misses);
+    ck_assert_int_eq(cache->hits, hits + 1);
+    destroy_level(lvl);
+} END_TEST
+
+START_TEST(door_toggle_knocks_out_cached_line) {
+    level *lvl = make_level(5);
+    struct los_cache *cache = lvl->sight_cache;
+    int x, y;
+    ck_assert(find_door(lvl, &x, &y));
+
+    ck_assert(!line_of_sight(lvl, x - 1, y, x + 1, y));
+    set_tile(lvl, x, y, DOOR_OPEN);
+    long misses = cache->misses;
+    ck_assert(line_of_sight(lvl, x - 1, y, x + 1, y));
+    ck_assert_int_eq(cache->misses, misses + 1);
+
+    set_tile(lvl, x, y, DOOR_CLOSED);
+    ck_assert(!line_of_sight(lvl, x - 1, y, x + 1, y));
+    ck_assert_int_eq(cache->misses, misses + 2);
+    destroy_level(lvl);
+} END_TEST
+
+// Once the door's edit has dropped out of the edit log the cache can no
+// longer tell it happened, and has to walk the line again
+START_TEST(cached_line_older_than_edit_log_is_walked_again) {
+    level *lvl = make_level(5);
+    struct los_cache *cache = lvl->sight_cache;
+    int x, y;
+    ck_assert(find_door(lvl, &x, &y));
+
+    ck_assert(!line_of_sight(lvl, x - 1, y, x + 1, y));
+    set_tile(lvl, x, y, DOOR_OPEN);
+    for (int i = 0; i < TERRAIN_EDIT_LOG; i++) edit_elsewhere(lvl, x, y);
+    long misses = cache->misses;
+    ck_assert(line_of_sight(lvl, x - 1, y, x + 1, y));
+    ck_assert_int_eq(cache->misses, misses + 1);
+
+    // Even with nothing in the box having changed
+    for (int i = 0; i < TERRAIN_EDIT_LOG; i++) edit_elsewhere(lvl, x, y);
+    ck_assert(line_of_sight(lvl, x - 1, y, x + 1, y));
+    ck_assert_int_eq(cache->misses, misses + 2);
+    destroy_level(lvl);
+} END_TEST
+
+START_TEST(cached_lines_match_walked_lines) {
+    static int lines[LOS_QUERIES][4];
+    for (long seed = 1; seed <= LOS_MAPS; seed++) {
+        level *lvl = make_level(seed);
+        srand(FIXED_SEED + seed);
+        // The same lines every round, so some answers come from the cache
+        for (int q = 0; q < LOS_QUERIES; q++) {
+            lines[q][0] = rand() % lvl->width;
+            lines[q][1] = rand() % lvl->height;
+            lines[q][2] = rand() % lvl->width;
+            lines[q][3] = rand() % lvl->height;
+        }
+
+        for (int round = 0; round < LOS_ROUNDS; round++) {
+            // A burst of edits, sometimes more than the log holds
+            int edits = rand() % 2 ? rand() % 4 : TERRAIN_EDIT_LOG + rand() % 8;
+            for (int i = 0; i < edits; i++) {
+                int x = 1 + rand() % (lvl->width - 2);
+                int y = 1 + rand() % (lvl->height - 2);
+                if (lvl->tiles[x][y] == DOOR_OPEN) {
+                    set_tile(lvl, x, y, DOOR_CLOSED);
+                } else if (lvl->tiles[x][y] == DOOR_CLOSED) {
+                    set_tile(lvl, x, y, DOOR_OPEN);
+                } else if (lvl->tiles[x][y] == TILE_FLOOR) {
+                    set_tile(lvl, x, y, DOOR_CLOSED);
+                }
+            }
+            for (int q = 0; q < LOS_QUERIES; q++) {
+                int *l = lines[q];
+                ck_assert_int_eq(line_of_sight(lvl, l[0], l[1], l[2], l[3]), uncached(lvl, l[0], l[1], l[2], l[3]));
+            }
+        }
+        ck_assert_int_gt(lvl->sight_cache->hits, 0);
+        destroy_level(lvl);
+    }
+} END_TEST
+
+Suite * make_los_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Line of Sight");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, los_setup, los_teardown);
+    tcase_add_test(tc_core, ray_table_walks_bresenham_lines);
+    tcase_add_test(tc_core, long_lines_walk_bresenham_lines);
+    tcase_add_test(tc_core, cached_line_outlasts_edits_elsewhere);
+    tcase_add_test(tc_core, door_toggle_knocks_out_cached_line);
+    tcase_add_test(tc_core, cached_line_older_than_edit_log_is_walked_again);
+    tcase_add_test(tc_core, cached_lines_match_walked_lines);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
@@ -0,0 +1,189 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../level/level.h"
+#include "../../path/distance_map.h"
+
+#define DMAP_MAPS 10
+#define DMAP_TURNS 200
+
+static int expected[MAX_MAP_WIDTH][MAX_MAP_HEIGHT];
+static int queue[MAX_MAP_WIDTH * MAX_MAP_HEIGHT];
+
+void distance_map_setup(void) {
+    // make_level() names the player after the user
+    setenv("USER", "tester", 0);
+};
+
+void distance_map_teardown(void) {
+};
+
+static bool blocks(level *lvl, int x, int y) {
+    return lvl->tiles[x][y] == TILE_WALL || lvl->tiles[x][y] == DOOR_CLOSED;
+}
+
+// Flood the map's goals from scratch and count the cells it disagrees on
+static int mismatches(level *lvl, struct distance_map *map) {
+    static const int neighbours[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+    int head = 0, tail = 0;
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            expected[x][y] = DISTANCE_UNREACHED;
+            if (map->goal[x][y] && !blocks(lvl, x, y)) {
+                expected[x][y] = 0;
+                queue[tail++] = x * lvl->height + y;
+            }
+        }
+    }
+    while (head < tail) {
+        int x = queue[head] / lvl->height;
+        int y = queue[head++] % lvl->height;
+        if (expected[x][y] == map->max_distance) continue;
+        for (int n = 0; n < 4; n++) {
+            int nx = x + neighbours[n][0];
+            int ny = y + neighbours[n][1];
+            if (nx < 0 || ny < 0 || nx >= lvl->width || ny >= lvl->height) continue;
+            if (blocks(lvl, nx, ny) || expected[nx][ny] != DISTANCE_UNREACHED) continue;
+            expected[nx][ny] = expected[x][y] + 1;
+            queue[tail++] = nx * lvl->height + ny;
+        }
+    }
+
+    int bad = 0;
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) bad += expected[x][y] != distance_to_goal(map, x, y);
+    }
+    return bad;
+}
+
+// A random tile away from the edge, for toggling
+static void random_inner(level *lvl, int *x, int *y) {
+    *x = 1 + rand() % (lvl->width - 2);
+    *y = 1 + rand() % (lvl->height - 2);
+}
+
+START_TEST(distance_map_matches_bfs_as_goal_moves) {
+    for (long seed = 1; seed <= DMAP_MAPS; seed++) {
+        level *lvl = make_level(seed);
+        struct distance_map *map = lvl->player_distance;
+        mobile *player = lvl->player;
+        srand(FIXED_SEED + seed);
+        ck_assert_int_eq(mismatches(lvl, map), 0);
+
+        for (int turn = 0; turn < DMAP_TURNS; turn++) {
+            int x = player->x + rand() % 3 - 1;
+            int y = player->y + rand() % 3 - 1;
+            if (blocks(lvl, x, y)) continue;
+            distance_map_move_goal(map, lvl, player->x, player->y, x, y);
+            player->x = x;
+            player->y = y;
+            ck_assert_int_eq(mismatches(lvl, map), 0);
+        }
+        destroy_level(lvl);
+    }
+} END_TEST
+
+START_TEST(distance_map_matches_bfs_as_doors_toggle) {
+    for (long seed = 1; seed <= DMAP_MAPS; seed++) {
+        level *lvl = make_level(seed);
+        struct distance_map *map = lvl->player_distance;
+        srand(FIXED_SEED + seed);
+
+        // Open every door, then shut and reopen them at random, walling
+        // the odd floor tile off on the way
+        for (int x = 0; x < lvl->width; x++) {
+            for (int y = 0; y < lvl->height; y++) {
+                if (lvl->tiles[x][y] != DOOR_CLOSED) continue;
+                lvl->tiles[x][y] = DOOR_OPEN;
+                level_terrain_changed(lvl, x, y);
+                ck_assert_int_eq(mismatches(lvl, map), 0);
+            }
+        }
+        for (int turn = 0; turn < DMAP_TURNS; turn++) {
+            int x, y;
+            random_inner(lvl, &x, &y);
+            if (lvl->tiles[x][y] == DOOR_OPEN) {
+                lvl->tiles[x][y] = DOOR_CLOSED;
+            } else if (lvl->tiles[x][y] == DOOR_CLOSED) {
+                lvl->tiles[x][y] = DOOR_OPEN;
+            } else if (lvl->tiles[x][y] == TILE_FLOOR && !map->goal[x][y]) {
+                lvl->tiles[x][y] = TILE_WALL;
+            } else {
+                continue;
+            }
+            level_terrain_changed(lvl, x, y);
+            ck_assert_int_eq(mismatches(lvl, map), 0);
+        }
+        destroy_level(lvl);
+    }
+} END_TEST
+
+START_TEST(distance_map_matches_bfs_with_many_goals) {
+    level *lvl = make_level(7);
+    struct distance_map *map = lvl->player_distance;
+    srand(FIXED_SEED);
+
+    for (int turn = 0; turn < DMAP_TURNS; turn++) {
+        int x, y;
+        random_inner(lvl, &x, &y);
+        if (blocks(lvl, x, y) || (x == lvl->player->x && y == lvl->player->y)) continue;
+        if (map->goal[x][y]) {
+            distance_map_remove_goal(map, lvl, x, y);
+        } else {
+            distance_map_add_goal(map, lvl, x, y);
+        }
+        ck_assert_int_eq(mismatches(lvl, map), 0);
+    }
+    destroy_level(lvl);
+} END_TEST
+
+START_TEST(distance_map_steps_downhill) {
+    level *lvl = make_level(3);
+    struct distance_map *map = lvl->player_distance;
+    int x = -1, y = -1;
+    int best = 0;
+    for (int xx = 0; xx < lvl->width; xx++) {
+        for (int yy = 0; yy < lvl->height; yy++) {
+            int d = distance_to_goal(map, xx, yy);
+            if (d != DISTANCE_UNREACHED && d > best && is_position_valid(lvl, xx, yy)) {
+                best = d;
+                x = xx;
+                y = yy;
+            }
+        }
+    }
+    ck_assert_int_gt(best, 1);
+
+    // Every step is one closer, until something stands in the way
+    int d = distance_to_goal(map, x, y);
+    while (distance_map_step(map, lvl, &x, &y)) {
+        ck_assert_int_eq(distance_to_goal(map, x, y), d - 1);
+        d--;
+    }
+    ck_assert_int_ge(d, 1);
+    ck_assert_int_lt(d, best);
+    destroy_level(lvl);
+} END_TEST
+
+Suite * make_distance_map_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Distance Map");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, distance_map_setup, distance_map_teardown);
+    tcase_add_test(tc_core, distance_map_matches_bfs_as_goal_moves);
+    tcase_add_test(tc_core, distance_map_matches_bfs_as_doors_toggle);
+    tcase_add_test(tc_core, distance_map_matches_bfs_with_many_goals);
+    tcase_add_test(tc_core, distance_map_steps_downhill);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
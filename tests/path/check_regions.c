@@ -0,0 +1,174 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../level/level.h"
+#include "../../path/regions.h"
+
+#define REGIONS_FIRST_MAP 5
+#define REGIONS_LAST_MAP 20
+#define REGIONS_ROUNDS 50
+#define REGIONS_QUERIES 100
+
+// Flood-filled components, -1 for blocked tiles, and each one's size
+static int component[MAX_MAP_WIDTH][MAX_MAP_HEIGHT];
+static int component_size[MAX_MAP_WIDTH * MAX_MAP_HEIGHT];
+static int queue[MAX_MAP_WIDTH * MAX_MAP_HEIGHT];
+// Each region's component, once its cells have been checked, else -1
+static int listed[MAX_MAP_WIDTH * MAX_MAP_HEIGHT];
+static int_vector cells;
+
+void regions_setup(void) {
+    // make_level() names the player after the user
+    setenv("USER", "tester", 0);
+    int_vector_init(&cells);
+};
+
+void regions_teardown(void) {
+    int_vector_free(&cells);
+};
+
+static bool blocks(level *lvl, int x, int y) {
+    return lvl->tiles[x][y] == TILE_WALL || lvl->tiles[x][y] == DOOR_CLOSED;
+}
+
+static void flood_fill(level *lvl) {
+    static const int neighbours[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+    int count = 0;
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) component[x][y] = -1;
+    }
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            if (blocks(lvl, x, y) || component[x][y] >= 0) continue;
+            int head = 0, tail = 0;
+            component[x][y] = count;
+            queue[tail++] = x * lvl->height + y;
+            while (head < tail) {
+                int cx = queue[head] / lvl->height;
+                int cy = queue[head++] % lvl->height;
+                for (int n = 0; n < 4; n++) {
+                    int nx = cx + neighbours[n][0];
+                    int ny = cy + neighbours[n][1];
+                    if (nx < 0 || ny < 0 || nx >= lvl->width || ny >= lvl->height) continue;
+                    if (blocks(lvl, nx, ny) || component[nx][ny] >= 0) continue;
+                    component[nx][ny] = count;
+                    queue[tail++] = nx * lvl->height + ny;
+                }
+            }
+            component_size[count++] = tail;
+        }
+    }
+}
+
+static void toggle_door(level *lvl, struct door *door, int tile) {
+    lvl->tiles[door->x][door->y] = tile;
+    level_terrain_changed(lvl, door->x, door->y);
+}
+
+// Every region's cells are exactly one flood-filled component
+static void check_region_cells(level *lvl) {
+    flood_fill(lvl);
+    for (int r = 0; r < lvl->rooms->room_count; r++) listed[r] = -1;
+    for (int x = 0; x < lvl->width; x++) {
+        for (int y = 0; y < lvl->height; y++) {
+            int region = region_at(lvl->regions, lvl, x, y);
+            ck_assert_int_eq(region == NO_REGION, component[x][y] < 0);
+            if (region == NO_REGION) continue;
+            if (listed[region] >= 0) {
+                ck_assert_int_eq(listed[region], component[x][y]);
+                continue;
+            }
+            listed[region] = component[x][y];
+
+            int_vector_clear(&cells);
+            region_cells(lvl->regions, lvl, region, &cells);
+            ck_assert_int_eq(cells.length, component_size[component[x][y]]);
+            for (int i = 0; i < cells.length; i++) {
+                ck_assert_int_eq(component[cells.e[i] / lvl->height][cells.e[i] % lvl->height], component[x][y]);
+            }
+        }
+    }
+}
+
+START_TEST(same_region_matches_flood_fill) {
+    for (long seed = REGIONS_FIRST_MAP; seed <= REGIONS_LAST_MAP; seed++) {
+        level *lvl = make_level(seed);
+        door_vector *doors = &lvl->rooms->doors;
+        srand(FIXED_SEED + seed);
+
+        for (int round = 0; round < REGIONS_ROUNDS; round++) {
+            if (doors->length > 0) {
+                struct door *door = &doors->e[rand() % doors->length];
+                toggle_door(lvl, door, lvl->tiles[door->x][door->y] == DOOR_OPEN ? DOOR_CLOSED : DOOR_OPEN);
+            }
+            flood_fill(lvl);
+            for (int q = 0; q < REGIONS_QUERIES; q++) {
+                int x0 = rand() % lvl->width;
+                int y0 = rand() % lvl->height;
+                int x1 = rand() % lvl->width;
+                int y1 = rand() % lvl->height;
+                bool joined = component[x0][y0] >= 0 && component[x0][y0] == component[x1][y1];
+                ck_assert_int_eq(same_region(lvl->regions, lvl, x0, y0, x1, y1), joined);
+            }
+        }
+        destroy_level(lvl);
+    }
+} END_TEST
+
+// Closing a door rebuilds the union-find, so open them all and close them
+// again one at a time
+START_TEST(region_cells_after_doors_close) {
+    for (long seed = REGIONS_FIRST_MAP; seed <= REGIONS_LAST_MAP; seed++) {
+        level *lvl = make_level(seed);
+        door_vector *doors = &lvl->rooms->doors;
+        for (int i = 0; i < doors->length; i++) toggle_door(lvl, &doors->e[i], DOOR_OPEN);
+        check_region_cells(lvl);
+
+        for (int i = 0; i < doors->length; i++) {
+            toggle_door(lvl, &doors->e[i], DOOR_CLOSED);
+            check_region_cells(lvl);
+        }
+        destroy_level(lvl);
+    }
+} END_TEST
+
+// Seeds 1 to 4 lay out a single room with no doors
+START_TEST(single_room_is_one_region) {
+    for (long seed = 1; seed <= 4; seed++) {
+        level *lvl = make_level(seed);
+        ck_assert_int_eq(lvl->rooms->room_count, 1);
+        ck_assert_int_eq(lvl->rooms->doors.length, 0);
+        check_region_cells(lvl);
+
+        // Walling off a tile isn't a door, and changes no region
+        int x = lvl->player->x;
+        int y = lvl->player->y;
+        int region = region_at(lvl->regions, lvl, x, y);
+        ck_assert_int_ne(region, NO_REGION);
+        regions_door_toggled(lvl->regions, lvl, x, y);
+        ck_assert_int_eq(region_at(lvl->regions, lvl, x, y), region);
+        destroy_level(lvl);
+    }
+} END_TEST
+
+Suite * make_regions_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Regions");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, regions_setup, regions_teardown);
+    tcase_add_test(tc_core, same_region_matches_flood_fill);
+    tcase_add_test(tc_core, region_cells_after_doors_close);
+    tcase_add_test(tc_core, single_room_is_one_region);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
@@ -0,0 +1,181 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../level/level.h"
+#include "../../path/room_graph.h"
+
+#define ROOM_GRAPH_MAPS 20
+#define ROOM_GRAPH_ROUNDS 20
+#define ROOM_GRAPH_QUERIES 20
+#define ROOM_GRAPH_TOGGLES 5
+
+static int steps[MAX_MAP_WIDTH][MAX_MAP_HEIGHT];
+static int queue[MAX_MAP_WIDTH * MAX_MAP_HEIGHT];
+static int_vector path;
+
+void room_graph_setup(void) {
+    // make_level() names the player after the user
+    setenv("USER", "tester", 0);
+    int_vector_init(&path);
+};
+
+void room_graph_teardown(void) {
+    int_vector_free(&path);
+};
+
+static bool blocks(level *lvl, int x, int y) {
+    return lvl->tiles[x][y] == TILE_WALL || lvl->tiles[x][y] == DOOR_CLOSED;
+}
+
+// Steps from (x, y) to every cell, -1 for the ones out of reach
+static void bfs(level *lvl, int x, int y) {
+    static const int neighbours[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+    int head = 0, tail = 0;
+    for (int xx = 0; xx < lvl->width; xx++) {
+        for (int yy = 0; yy < lvl->height; yy++) steps[xx][yy] = -1;
+    }
+    steps[x][y] = 0;
+    queue[tail++] = x * lvl->height + y;
+    while (head < tail) {
+        x = queue[head] / lvl->height;
+        y = queue[head++] % lvl->height;
+        for (int n = 0; n < 4; n++) {
+            int nx = x + neighbours[n][0];
+            int ny = y + neighbours[n][1];
+            if (nx < 0 || ny < 0 || nx >= lvl->width || ny >= lvl->height) continue;
+            if (blocks(lvl, nx, ny) || steps[nx][ny] >= 0) continue;
+            steps[nx][ny] = steps[x][y] + 1;
+            queue[tail++] = nx * lvl->height + ny;
+        }
+    }
+}
+
+static void random_floor(level *lvl, int *x, int *y) {
+    do {
+        *x = rand() % lvl->width;
+        *y = rand() % lvl->height;
+    } while (blocks(lvl, *x, *y));
+}
+
+static void toggle_door(level *lvl, struct door *door) {
+    lvl->tiles[door->x][door->y] = lvl->tiles[door->x][door->y] == DOOR_OPEN ? DOOR_CLOSED : DOOR_OPEN;
+    level_terrain_changed(lvl, door->x, door->y);
+}
+
+// find_path() from (x, y), which bfs() was run from, agrees on whether
+// (to_x, to_y) can be reached and how far, and gives a path of orthogonal
+// steps over open cells that gets there
+static void check_path(level *lvl, int x, int y, int to_x, int to_y) {
+    bool found = find_path(lvl->rooms, lvl, x, y, to_x, to_y, &path);
+    ck_assert_int_eq(found, steps[to_x][to_y] >= 0);
+    if (!found) return;
+    ck_assert_int_eq(path.length, steps[to_x][to_y]);
+
+    for (int i = path.length - 1; i >= 0; i--) {
+        int nx = path.e[i] / lvl->height;
+        int ny = path.e[i] % lvl->height;
+        ck_assert_int_eq(abs(nx - x) + abs(ny - y), 1);
+        ck_assert(!blocks(lvl, nx, ny));
+        x = nx;
+        y = ny;
+    }
+    ck_assert_int_eq(x, to_x);
+    ck_assert_int_eq(y, to_y);
+}
+
+START_TEST(find_path_matches_bfs_as_doors_toggle) {
+    for (long seed = 1; seed <= ROOM_GRAPH_MAPS; seed++) {
+        level *lvl = make_level(seed);
+        door_vector *doors = &lvl->rooms->doors;
+        srand(FIXED_SEED + seed);
+
+        for (int round = 0; round < ROOM_GRAPH_ROUNDS; round++) {
+            for (int i = 0; i < ROOM_GRAPH_TOGGLES && doors->length > 0; i++) {
+                toggle_door(lvl, &doors->e[rand() % doors->length]);
+            }
+            int x, y;
+            random_floor(lvl, &x, &y);
+            bfs(lvl, x, y);
+            for (int q = 0; q < ROOM_GRAPH_QUERIES; q++) {
+                int to_x, to_y;
+                random_floor(lvl, &to_x, &to_y);
+                check_path(lvl, x, y, to_x, to_y);
+            }
+            // Doors themselves, open ones at either end of a route
+            for (int i = 0; i < doors->length; i++) {
+                if (!blocks(lvl, doors->e[i].x, doors->e[i].y)) check_path(lvl, x, y, doors->e[i].x, doors->e[i].y);
+            }
+        }
+        destroy_level(lvl);
+    }
+} END_TEST
+
+START_TEST(find_path_to_itself_is_empty) {
+    level *lvl = make_level(2);
+    int x, y;
+    srand(FIXED_SEED);
+    random_floor(lvl, &x, &y);
+    ck_assert(find_path(lvl->rooms, lvl, x, y, x, y, &path));
+    ck_assert_int_eq(path.length, 0);
+    destroy_level(lvl);
+} END_TEST
+
+// Routes kept for a room stay kept however many edits happen elsewhere
+START_TEST(room_routes_outlast_edits_elsewhere) {
+    for (long seed = 5; seed <= ROOM_GRAPH_MAPS; seed++) {
+        level *lvl = make_level(seed);
+        struct room_graph *graph = lvl->rooms;
+        if (graph->doors.length < 2) {
+            destroy_level(lvl);
+            continue;
+        }
+        srand(FIXED_SEED + seed);
+        for (int i = 0; i < graph->doors.length; i++) {
+            if (lvl->tiles[graph->doors.e[i].x][graph->doors.e[i].y] == DOOR_CLOSED) toggle_door(lvl, &graph->doors.e[i]);
+        }
+
+        int x, y, to_x, to_y;
+        random_floor(lvl, &x, &y);
+        random_floor(lvl, &to_x, &to_y);
+        bfs(lvl, x, y);
+        struct door *far = &graph->doors.e[0];
+        for (int edit = 0; edit < 2 * TERRAIN_EDIT_LOG; edit++) {
+            // Doors sit in the walls between rooms, outside every room's
+            // floor, so toggling one twice leaves every route standing
+            toggle_door(lvl, far);
+            toggle_door(lvl, far);
+            check_path(lvl, x, y, to_x, to_y);
+
+            for (int r = 0; r < graph->room_count; r++) {
+                struct room *room = &graph->rooms[r];
+                int count = room->doors.length;
+                bool kept = false;
+                for (int i = 0; i < count * count; i++) kept |= room->lengths[i] != ROUTE_UNKNOWN;
+                if (kept) ck_assert_int_eq(room->version, lvl->terrain_version);
+            }
+        }
+        destroy_level(lvl);
+    }
+} END_TEST
+
+Suite * make_room_graph_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Room Graph");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, room_graph_setup, room_graph_teardown);
+    tcase_add_test(tc_core, find_path_matches_bfs_as_doors_toggle);
+    tcase_add_test(tc_core, find_path_to_itself_is_empty);
+    tcase_add_test(tc_core, room_routes_outlast_edits_elsewhere);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
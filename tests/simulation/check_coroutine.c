@@ -0,0 +1,108 @@
+#include <stdbool.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../simulation/coroutine.h"
+
+void coroutine_setup(void) {
+};
+
+void coroutine_teardown(void) {
+};
+
+struct tracer {
+    struct coroutine co;
+    struct simulation *sim;
+    int step;
+    sim_clock fired[10];
+    int fire_count;
+};
+
+static void trace(struct tracer *t) {
+    if (t->fire_count < 10) t->fired[t->fire_count] = t->sim->current_clock;
+    t->fire_count++;
+}
+
+void traced_fire(void *context, void *st) {
+    struct tracer *t = (struct tracer*)st;
+
+    CO_BEGIN(&t->co);
+    for (t->step = 0; t->step < 3; t->step++) {
+        trace(t);
+        CO_WAIT(&t->co, 5);
+    }
+    trace(t);
+    CO_WAIT_EVENT(&t->co, DAMAGE);
+    trace(t);
+    CO_WAIT(&t->co, 100);
+    CO_END(&t->co);
+}
+
+bool traced_wake(void *st) {
+    return coroutine_wake(&((struct tracer*)st)->co);
+}
+
+int traced_next_firing(void *context, void *st, struct event_listener *listeners) {
+    return coroutine_next_firing(&((struct tracer*)st)->co, listeners, traced_wake);
+}
+
+START_TEST(waits_resume_in_place) {
+    struct simulation *sim = make_simulation(NULL);
+    struct event_listener listeners[SENSORY_EVENT_COUNT];
+    struct tracer t = { .co = COROUTINE_INIT, .sim = sim, .fire_count = 0 };
+    struct agent a;
+
+    a.state = &t;
+    a.kind = 0;
+    a.next_firing = traced_next_firing;
+    a.fire = traced_fire;
+    a.plan = NULL;
+    a.apply = NULL;
+    a.listeners = listeners;
+    schedule_event(sim, simulation_push_agent(sim, &a), 0);
+
+    // Three timed waits, then parked on DAMAGE however long we run
+    sync_simulation(sim, 1000);
+    ck_assert_int_eq(t.fire_count, 4);
+    ck_assert(t.fired[0] == 0);
+    ck_assert(t.fired[1] == 5);
+    ck_assert(t.fired[2] == 10);
+    ck_assert(t.fired[3] == 15);
+    ck_assert(listeners[VISION_CHANGE].handler == NULL);
+    ck_assert(listeners[DAMAGE].handler == traced_wake);
+
+    // The event wakes it where it left off, and only the awaited one does
+    simulation_call_event_handler(sim, &listeners[DAMAGE]);
+    ck_assert(listeners[DAMAGE].handler == NULL);
+    sync_simulation(sim, 100);
+    ck_assert_int_eq(t.fire_count, 5);
+    ck_assert(t.fired[4] == 15);
+
+    // Falling off the end at 115 starts over on the next firing
+    sync_simulation(sim, 215);
+    ck_assert_int_eq(t.fire_count, 6);
+    ck_assert(t.fired[5] == 215);
+    ck_assert_int_eq(t.step, 0);
+
+    destroy_simulation(sim);
+} END_TEST
+
+Suite * make_coroutine_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Coroutine");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, coroutine_setup, coroutine_teardown);
+    tcase_add_test(tc_core, waits_resume_in_place);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
@@ -0,0 +1,178 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../simulation/event_queue.h"
+
+void event_queue_setup(void) {
+};
+
+void event_queue_teardown(void) {
+};
+
+START_TEST(development_target) {
+    struct event a, b, c, d, e;
+    event_queue *q = make_event_queue();
+    event_queue_push(q, &a, 10);
+    event_queue_push(q, &b, 9);
+    event_queue_push(q, &c, 8);
+    event_queue_push(q, &d, 20);
+    struct event *new_data;
+    sim_clock priority;
+
+    event_queue_peek(q, &new_data, &priority);
+    ck_assert(new_data == &c);
+    ck_assert(priority == 8);
+
+    event_queue_pop(q, &new_data, &priority);
+    ck_assert(new_data == &c);
+    ck_assert(priority == 8);
+    ck_assert_int_eq(c.queue_index, -1);
+
+    event_queue_pop(q, &new_data, &priority);
+    ck_assert(new_data == &b);
+    ck_assert(priority == 9);
+
+    event_queue_push(q, &e, 0);
+    event_queue_pop(q, &new_data, &priority);
+    ck_assert(new_data == &e);
+    ck_assert(priority == 0);
+
+    event_queue_pop(q, &new_data, &priority);
+    ck_assert(new_data == &a);
+    ck_assert(priority == 10);
+
+    event_queue_pop(q, &new_data, &priority);
+    ck_assert(new_data == &d);
+    ck_assert(priority == 20);
+
+    event_queue_peek(q, &new_data, &priority);
+    ck_assert(new_data == NULL);
+    ck_assert(priority == CLOCK_NEVER);
+    ck_assert_int_eq(q->length, 0);
+
+    destroy_event_queue(q);
+} END_TEST
+
+START_TEST(update_and_remove) {
+    const int len = 1000;
+    struct event events[len];
+    sim_clock clocks[len];
+    bool queued[len];
+    struct event *cur_d;
+    sim_clock cur_p, last_p;
+
+    srand(FIXED_SEED);
+    event_queue *q = make_event_queue();
+    for (int i = 0; i < len; i++) {
+        clocks[i] = rand() % 100000;
+        queued[i] = true;
+        event_queue_push(q, &events[i], clocks[i]);
+    }
+
+    // Move every event somewhere else, either way, and drop a few
+    for (int i = 0; i < len; i++) {
+        if (i % 7 == 0) {
+            event_queue_remove(q, &events[i]);
+            ck_assert_int_eq(events[i].queue_index, -1);
+            queued[i] = false;
+        } else {
+            clocks[i] = (i % 3 == 0) ? CLOCK_NEVER : rand() % 100000;
+            event_queue_update(q, &events[i], clocks[i]);
+        }
+    }
+
+    last_p = 0;
+    while (q->length > 0) {
+        event_queue_pop(q, &cur_d, &cur_p);
+        int i = cur_d - events;
+        ck_assert(queued[i]);
+        ck_assert(cur_p == clocks[i]);
+        ck_assert(cur_p >= last_p);
+        queued[i] = false;
+        last_p = cur_p;
+    }
+    for (int i = 0; i < len; i++) {
+        ck_assert(!queued[i]);
+    }
+
+    destroy_event_queue(q);
+} END_TEST
+
+START_TEST(big_insert_with_interspersed_pops) {
+    const int len = 10000;
+    sim_clock last_p;
+    sim_clock cur_p;
+    struct event *cur_d;
+    int total_popped;
+    struct event *events = malloc(len * sizeof(struct event));
+
+    srand(FIXED_SEED);
+    event_queue *q = make_event_queue();
+    for (int i = 0; i < len; i++) {
+        event_queue_push(q, &events[i], rand());
+    }
+
+    // Everything pushed during the drain is later than anything popped so
+    // far, so the output must come out sorted
+    last_p = 0;
+    total_popped = 0;
+    while (q->length > 0) {
+        event_queue_pop(q, &cur_d, &cur_p);
+        ck_assert(cur_p >= last_p);
+        last_p = cur_p;
+        total_popped += 1;
+        if (total_popped <= len) {
+            event_queue_push(q, cur_d, cur_p + rand());
+        }
+    }
+    ck_assert_int_eq(total_popped, len*2);
+
+    free((void*)events);
+
+    destroy_event_queue(q);
+} END_TEST
+
+START_TEST(clocks_past_int_max) {
+    event_queue *q = make_event_queue();
+    struct event *e;
+    struct event never, late, later;
+    sim_clock clock;
+
+    event_queue_push(q, &never, CLOCK_NEVER);
+    event_queue_push(q, &later, (sim_clock)INT_MAX + 2000);
+    event_queue_push(q, &late, (sim_clock)INT_MAX + 1000);
+
+    event_queue_pop(q, &e, &clock);
+    ck_assert(clock == (sim_clock)INT_MAX + 1000);
+    event_queue_pop(q, &e, &clock);
+    ck_assert(clock == (sim_clock)INT_MAX + 2000);
+    event_queue_pop(q, &e, &clock);
+    ck_assert(clock == CLOCK_NEVER);
+
+    destroy_event_queue(q);
+} END_TEST
+
+Suite * make_event_queue_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Event Queue");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, event_queue_setup, event_queue_teardown);
+    tcase_add_test(tc_core, development_target);
+    tcase_add_test(tc_core, update_and_remove);
+    tcase_add_test(tc_core, big_insert_with_interspersed_pops);
+    tcase_add_test(tc_core, clocks_past_int_max);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
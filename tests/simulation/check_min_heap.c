@@ -66,7 +66,8 @@ START_TEST(big_insert_with_interspersed_pops) {
     const int len = 10000;
     int data[len*2];
     int last_p, last_pp;
-    int cur_p, cur_d;
+    int cur_p;
+    int *cur_d;
     int total_popped;
     int total_pushed;
 
@@ -0,0 +1,109 @@
+#include <stdbool.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../simulation/sensory_bus.h"
+
+#define GRID 40
+
+void sensory_bus_setup(void) {
+};
+
+void sensory_bus_teardown(void) {
+};
+
+bool count_noise(void *st) {
+    *(int*)st += 1;
+    return false;
+}
+
+int listening_next_firing(void *context, void *st, struct event_listener *listeners) {
+    listeners[NOISE].handler = count_noise;
+    return INT_MAX;
+}
+
+void silent_fire(void *context, void *st) {
+}
+
+START_TEST(only_nearby_listeners_hear) {
+    struct simulation *sim = make_simulation(NULL);
+    struct spatial_index *index = make_spatial_index(GRID, GRID, 8);
+    struct sensory_bus *bus = make_sensory_bus(index);
+    int heard[GRID][GRID];
+    struct event_listener listeners[GRID][GRID][SENSORY_EVENT_COUNT];
+    int ids[GRID][GRID];
+
+    // One listener on every tile
+    for (int x = 0; x < GRID; x++) {
+        for (int y = 0; y < GRID; y++) {
+            struct agent a;
+            heard[x][y] = 0;
+            a.state = &heard[x][y];
+            a.kind = 0;
+            a.next_firing = listening_next_firing;
+            a.fire = silent_fire;
+            a.plan = NULL;
+            a.apply = NULL;
+            a.listeners = listeners[x][y];
+            agent_handle handle = simulation_push_agent(sim, &a);
+            schedule_event(sim, handle, 0);
+            ids[x][y] = spatial_index_insert(index, &heard[x][y], x, y);
+            sensory_bus_subscribe(bus, ids[x][y], handle, listeners[x][y]);
+        }
+    }
+
+    int delivered = sensory_bus_publish(bus, sim, NOISE, 10, 12, 5);
+    int expected = 0;
+    for (int x = 0; x < GRID; x++) {
+        for (int y = 0; y < GRID; y++) {
+            bool near = (x-10)*(x-10) + (y-12)*(y-12) <= 25;
+            ck_assert_int_eq(heard[x][y], near ? 1 : 0);
+            if (near) expected++;
+        }
+    }
+    ck_assert_int_eq(delivered, expected);
+
+    // Nobody listens for damage, and the edge of the map clips
+    ck_assert_int_eq(sensory_bus_publish(bus, sim, DAMAGE, 10, 12, 5), 0);
+    ck_assert_int_eq(sensory_bus_publish(bus, sim, NOISE, 0, 0, 1), 3);
+
+    // Moving across cells in the index and unsubscribing are both seen
+    spatial_index_move(index, ids[0][0], 30, 30);
+    sensory_bus_unsubscribe(bus, ids[30][30]);
+    heard[0][0] = 0;
+    heard[30][30] = 0;
+    sensory_bus_publish(bus, sim, NOISE, 30, 30, 0);
+    ck_assert_int_eq(heard[0][0], 1);
+    ck_assert_int_eq(heard[30][30], 0);
+
+    // Entries nobody subscribed are passed over
+    int quiet = 0;
+    spatial_index_insert(index, &quiet, 5, 5);
+    heard[5][5] = 0;
+    ck_assert_int_eq(sensory_bus_publish(bus, sim, NOISE, 5, 5, 0), 1);
+    ck_assert_int_eq(heard[5][5], 1);
+
+    destroy_sensory_bus(bus);
+    destroy_spatial_index(index);
+    destroy_simulation(sim);
+} END_TEST
+
+Suite * make_sensory_bus_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Sensory Bus");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, sensory_bus_setup, sensory_bus_teardown);
+    tcase_add_test(tc_core, only_nearby_listeners_hear);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
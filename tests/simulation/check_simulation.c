@@ -1,5 +1,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <math.h>
 #include <check.h>
 
 #include "../../helpers.h"
@@ -13,42 +15,447 @@ void simulation_setup(void) {
 void simulation_teardown(void) {
 };
 
-int mock_next_firing(void* st, enum sensory_events **ilist) {
+int mock_next_firing(void *context, void* st, struct event_listener *listeners) {
     float rate = 1.0;
     float r = frand();
-    return (1 - powf(M_E, -rate*r)) * 1000;
+    return 1 + (1 - powf(M_E, -rate*r)) * 1000;
 }
 
-void mock_fire(void* st) {
+void mock_fire(void *context, void* st) {
     *(int*)st += 1;
 }
 
 START_TEST(development_target) {
-    struct simulation sim;
-    sim.num_agents = 10000;
-    sim.agents = malloc(sim.num_agents*sizeof(struct agent));
-    sim.queue = make_mheap();
+    const int num_agents = 10000;
+    struct simulation *sim = make_simulation(NULL);
+    int *counts = malloc(num_agents*sizeof(int));
+    struct event_listener *listeners = malloc(num_agents*SENSORY_EVENT_COUNT*sizeof(struct event_listener));
+    agent_handle *handles = malloc(num_agents*sizeof(agent_handle));
 
-    for (int i = 0; i < sim.num_agents; i++) {
-        sim.agents[i].state = malloc(sizeof(int));
-        *(int*)sim.agents[i].state = 0;
-        sim.agents[i].next_firing = mock_next_firing;
-        sim.agents[i].fire = mock_fire;
+    srand(FIXED_SEED);
+    for (int i = 0; i < num_agents; i++) {
+        struct agent a;
+        counts[i] = 0;
+        a.state = &counts[i];
+        a.next_firing = mock_next_firing;
+        a.fire = mock_fire;
+        a.kind = 0;
+        a.plan = NULL;
+        a.apply = NULL;
+        a.listeners = &listeners[i*SENSORY_EVENT_COUNT];
+        handles[i] = simulation_push_agent(sim, &a);
+    }
+    for (int i = 0; i < num_agents; i++) {
+        schedule_event(sim, handles[i], 0);
+    }
+
+    sync_simulation(sim, 3000);
+
+    for (int i = 0; i < num_agents; i++) {
+        ck_assert(counts[i] >= 2);
+    }
+
+    destroy_simulation(sim);
+    free((void*)handles);
+    free((void*)listeners);
+    free((void*)counts);
+} END_TEST
+
+START_TEST(events_are_recycled) {
+    const int num_agents = 10;
+    struct simulation *sim = make_simulation(NULL);
+    int counts[num_agents];
+    struct event_listener listeners[num_agents*SENSORY_EVENT_COUNT];
+
+    srand(FIXED_SEED);
+    for (int i = 0; i < num_agents; i++) {
+        struct agent a;
+        counts[i] = 0;
+        a.state = &counts[i];
+        a.next_firing = mock_next_firing;
+        a.fire = mock_fire;
+        a.kind = 0;
+        a.plan = NULL;
+        a.apply = NULL;
+        a.listeners = &listeners[i*SENSORY_EVENT_COUNT];
+        schedule_event(sim, simulation_push_agent(sim, &a), 0);
+    }
+
+    sync_simulation(sim, 100000);
+
+    // Agents keep their event between firings, so one block was enough
+    ck_assert_int_eq(sim->event_blocks.length, 1);
+    ck_assert(counts[0] > 50);
+
+    destroy_simulation(sim);
+} END_TEST
+
+int fixed_next_firing(void *context, void* st, struct event_listener *listeners) {
+    return 1000 + (*(int*)st * 37) % 700;
+}
+
+START_TEST(wheel_matches_heap) {
+    const int num_agents = 500;
+    struct simulation *heap_sim = make_simulation(NULL);
+    struct simulation *wheel_sim = make_simulation_with_queue(NULL, WHEEL_QUEUE, 1000);
+    int heap_counts[num_agents];
+    int wheel_counts[num_agents];
+    agent_handle heap_handles[num_agents];
+    agent_handle wheel_handles[num_agents];
+    struct event_listener listeners[2*num_agents*SENSORY_EVENT_COUNT];
+
+    for (int i = 0; i < num_agents; i++) {
+        struct agent a;
+        a.next_firing = fixed_next_firing;
+        a.fire = mock_fire;
+        a.kind = 0;
+        a.plan = NULL;
+        a.apply = NULL;
+
+        heap_counts[i] = i;
+        a.state = &heap_counts[i];
+        a.listeners = &listeners[i*SENSORY_EVENT_COUNT];
+        heap_handles[i] = simulation_push_agent(heap_sim, &a);
+
+        wheel_counts[i] = i;
+        a.state = &wheel_counts[i];
+        a.listeners = &listeners[(num_agents+i)*SENSORY_EVENT_COUNT];
+        wheel_handles[i] = simulation_push_agent(wheel_sim, &a);
+    }
+    for (int i = 0; i < num_agents; i++) {
+        schedule_event(heap_sim, heap_handles[i], 0);
+        schedule_event(wheel_sim, wheel_handles[i], 0);
+    }
+
+    for (int turn = 1; turn <= 50; turn++) {
+        sync_simulation(heap_sim, turn * 1000);
+        sync_simulation(wheel_sim, turn * 1000);
+        ck_assert(heap_sim->current_clock == wheel_sim->current_clock);
+    }
+    for (int i = 0; i < num_agents; i++) {
+        ck_assert_int_eq(heap_counts[i], wheel_counts[i]);
+    }
+
+    destroy_simulation(heap_sim);
+    destroy_simulation(wheel_sim);
+} END_TEST
+
+struct spawner {
+    struct simulation *sim;
+    int *counts;
+    struct event_listener *listeners;
+    int spawned;
+    int limit;
+};
+
+void spawning_fire(void *context, void* st) {
+    struct spawner *sp = (struct spawner*)st;
+    if (sp->spawned >= sp->limit) return;
+
+    // Enough agents to force sim->agents to reallocate mid-sync
+    for (int i = 0; i < 150 && sp->spawned < sp->limit; i++) {
+        struct agent a;
+        int n = sp->spawned++;
+        sp->counts[n] = 0;
+        a.state = &sp->counts[n];
+        a.next_firing = fixed_next_firing;
+        a.fire = mock_fire;
+        a.kind = 0;
+        a.plan = NULL;
+        a.apply = NULL;
+        a.listeners = &sp->listeners[n*SENSORY_EVENT_COUNT];
+        schedule_event(sp->sim, simulation_push_agent(sp->sim, &a), sp->sim->current_clock);
+    }
+}
+
+int spawner_next_firing(void *context, void* st, struct event_listener *listeners) {
+    return 1000;
+}
+
+START_TEST(spawning_while_firing) {
+    const int limit = 1000;
+    struct simulation *sim = make_simulation(NULL);
+    int counts[limit];
+    struct event_listener listeners[(limit+1)*SENSORY_EVENT_COUNT];
+    struct spawner sp = { .sim = sim, .counts = counts, .listeners = listeners, .spawned = 0, .limit = limit };
+    struct agent a;
+
+    a.state = &sp;
+    a.next_firing = spawner_next_firing;
+    a.fire = spawning_fire;
+    a.kind = 0;
+    a.plan = NULL;
+    a.apply = NULL;
+    a.listeners = &listeners[limit*SENSORY_EVENT_COUNT];
+    agent_handle spawner = simulation_push_agent(sim, &a);
+    schedule_event(sim, spawner, 0);
+
+    sync_simulation(sim, 20000);
+
+    ck_assert_int_eq(sp.spawned, limit);
+    ck_assert_ptr_eq(simulation_get_agent(sim, spawner)->state, &sp);
+    for (int i = 0; i < limit; i++) {
+        ck_assert(counts[i] > 0);
+    }
+
+    destroy_simulation(sim);
+} END_TEST
+
+bool always_cancel(void *st) {
+    return true;
+}
+
+int sleeping_next_firing(void *context, void* st, struct event_listener *listeners) {
+    listeners[DAMAGE].handler = always_cancel;
+    return INT_MAX;
+}
+
+static void check_cancellations_reschedule_in_place(struct simulation *sim) {
+    const int num_agents = 100;
+    int counts[num_agents];
+    struct event_listener listeners[num_agents*SENSORY_EVENT_COUNT];
+
+    for (int i = 0; i < num_agents; i++) {
+        struct agent a;
+        counts[i] = 0;
+        a.state = &counts[i];
+        a.next_firing = sleeping_next_firing;
+        a.fire = mock_fire;
+        a.kind = 0;
+        a.plan = NULL;
+        a.apply = NULL;
+        a.listeners = &listeners[i*SENSORY_EVENT_COUNT];
+        schedule_event(sim, simulation_push_agent(sim, &a), 0);
+    }
 
-        enum sensory_events *ilist;
-        int next_firing = sim.agents[i].next_firing(&sim.agents[i].state, &ilist);
-        mheap_push(sim.queue, &sim.agents[i], next_firing);
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < num_agents; i++) {
+            simulation_call_event_handler(sim, &listeners[i*SENSORY_EVENT_COUNT + DAMAGE]);
+        }
+        sync_simulation(sim, round * 1000);
     }
 
-    sync_simulation(&sim, 3000);
+    // Each agent's one event moved, nothing was left behind
+    int length = sim->queue != NULL ? sim->queue->length : sim->wheel->length;
+    ck_assert_int_eq(length, num_agents);
+    ck_assert_int_eq(sim->event_blocks.length, 1);
 
-    destroy_mheap(sim.queue);
-    for (int i = 0; i < sim.num_agents; i++) {
-        free((void*)sim.agents[i].state);
+    destroy_simulation(sim);
+}
+
+START_TEST(cancellations_reschedule_in_place) {
+    check_cancellations_reschedule_in_place(make_simulation(NULL));
+    check_cancellations_reschedule_in_place(make_simulation_with_queue(NULL, WHEEL_QUEUE, 1000));
+} END_TEST
+
+static void check_retired_agents_stop_firing(struct simulation *sim) {
+    const int num_agents = 100;
+    int counts[num_agents];
+    int spare = 0;
+    struct event_listener listeners[(num_agents+1)*SENSORY_EVENT_COUNT];
+    agent_handle handles[num_agents];
+
+    srand(FIXED_SEED);
+    for (int i = 0; i < num_agents; i++) {
+        struct agent a;
+        counts[i] = 0;
+        a.state = &counts[i];
+        a.next_firing = mock_next_firing;
+        a.fire = mock_fire;
+        a.kind = 0;
+        a.plan = NULL;
+        a.apply = NULL;
+        a.listeners = &listeners[i*SENSORY_EVENT_COUNT];
+        handles[i] = simulation_push_agent(sim, &a);
+        schedule_event(sim, handles[i], 0);
+    }
+    sync_simulation(sim, 1000);
+
+    for (int i = 0; i < num_agents; i += 2) {
+        simulation_retire_agent(sim, handles[i]);
+        ck_assert_ptr_eq(simulation_get_agent(sim, handles[i]), NULL);
     }
-    free((void*)sim.agents);
+    int length = sim->queue != NULL ? sim->queue->length : sim->wheel->length;
+    ck_assert_int_eq(length, num_agents / 2);
 
+    int frozen[num_agents];
+    for (int i = 0; i < num_agents; i++) frozen[i] = counts[i];
+    sync_simulation(sim, 10000);
+    for (int i = 0; i < num_agents; i++) {
+        if (i % 2 == 0) {
+            ck_assert_int_eq(counts[i], frozen[i]);
+        } else {
+            ck_assert(counts[i] > frozen[i]);
+        }
+    }
+
+    // A new agent takes over a retired slot, the old handle stays stale
+    struct agent a;
+    a.state = &spare;
+    a.next_firing = mock_next_firing;
+    a.fire = mock_fire;
+    a.kind = 0;
+    a.plan = NULL;
+    a.apply = NULL;
+    a.listeners = &listeners[num_agents*SENSORY_EVENT_COUNT];
+    agent_handle reused = simulation_push_agent(sim, &a);
+    ck_assert_int_eq(sim->agents.length, num_agents);
+    ck_assert_ptr_eq(simulation_get_agent(sim, handles[reused.index]), NULL);
+    ck_assert_ptr_eq(simulation_get_agent(sim, reused)->state, &spare);
+    ck_assert_int_eq(sim->event_blocks.length, 1);
+
+    destroy_simulation(sim);
+}
+
+START_TEST(retired_agents_stop_firing) {
+    check_retired_agents_stop_firing(make_simulation(NULL));
+    check_retired_agents_stop_firing(make_simulation_with_queue(NULL, WHEEL_QUEUE, 1000));
+} END_TEST
+
+int ten_tick_firing(void *context, void* st, struct event_listener *listeners) {
+    return 10;
+}
+
+// Stretch every other agent, telling them apart by where their count lives
+int odd_agents_lod(void *context, void* st, int delay) {
+    return ((int*)st - (int*)context) % 2 == 1 ? delay * 4 : delay;
+}
+
+START_TEST(lod_stretches_delays) {
+    const int num_agents = 100;
+    int counts[num_agents];
+    struct event_listener listeners[num_agents*SENSORY_EVENT_COUNT];
+    struct simulation *sim = make_simulation((void*)counts);
+
+    simulation_set_lod(sim, odd_agents_lod);
+    for (int i = 0; i < num_agents; i++) {
+        struct agent a;
+        counts[i] = 0;
+        a.state = &counts[i];
+        a.kind = 0;
+        a.next_firing = ten_tick_firing;
+        a.fire = mock_fire;
+        a.plan = NULL;
+        a.apply = NULL;
+        a.listeners = &listeners[i*SENSORY_EVENT_COUNT];
+        schedule_event(sim, simulation_push_agent(sim, &a), 0);
+    }
+
+    sync_simulation(sim, 1000);
+
+    for (int i = 0; i < num_agents; i++) {
+        ck_assert_int_eq(counts[i], i % 2 == 1 ? 25 : 100);
+    }
+
+    destroy_simulation(sim);
+} END_TEST
+
+START_TEST(stats_count_firings) {
+    const int num_agents = 10;
+    int counts[num_agents];
+    struct event_listener listeners[num_agents*SENSORY_EVENT_COUNT];
+    struct simulation *sim = make_simulation(NULL);
+
+    ck_assert_ptr_eq(simulation_get_stats(sim), NULL);
+    simulation_enable_stats(sim);
+    for (int i = 0; i < num_agents; i++) {
+        struct agent a;
+        counts[i] = 0;
+        a.state = &counts[i];
+        a.kind = i % 2;
+        a.next_firing = ten_tick_firing;
+        a.fire = mock_fire;
+        a.plan = NULL;
+        a.apply = NULL;
+        a.listeners = &listeners[i*SENSORY_EVENT_COUNT];
+        schedule_event(sim, simulation_push_agent(sim, &a), 0);
+    }
+
+    sync_simulation(sim, 100);
+    sync_simulation(sim, 200);
+
+    const struct sim_stats *stats = simulation_get_stats(sim);
+    ck_assert_int_eq(stats->syncs, 2);
+    ck_assert_int_eq(stats->events_fired, 200);
+    ck_assert_int_eq(stats->stale_pops, 0);
+    ck_assert_int_eq(stats->kinds[0].fired, 100);
+    ck_assert_int_eq(stats->kinds[1].fired, 100);
+    ck_assert_int_eq(stats->kinds[0].scheduled, 105);
+    ck_assert_int_eq(stats->events_per_sync.count, 2);
+    ck_assert_int_eq(stats->events_per_sync.max, 100);
+    ck_assert_int_eq(stats->queue_length.max, num_agents);
+    // Every delay was ten ticks, which lands in the 8 to 16 bucket
+    ck_assert_int_eq(stats->reschedule_latency.count, 210);
+    ck_assert_int_eq(stats->reschedule_latency.buckets[4], 210);
+
+    destroy_simulation(sim);
+} END_TEST
+
+struct planner {
+    int id;
+    unsigned int seed;
+};
+
+int turn_next_firing(void *context, void* st, struct event_listener *listeners) {
+    return 1 + rand_int(3);
+}
+
+void busy_plan(void *context, void* st, struct intent *intent) {
+    struct planner *p = (struct planner*)st;
+    // Enough work per agent that the threads overlap
+    for (int i = 0; i < 100; i++) intent->dx += rand_r(&p->seed) % 3;
+    intent->action = p->id;
+}
+
+void log_apply(void *context, void* st, struct intent *intent) {
+    intent_vector_push((intent_vector*)context, *intent);
+}
+
+static void run_batches(intent_vector *log, int thread_count) {
+    const int num_agents = 1000;
+    struct simulation *sim = make_simulation_with_queue((void*)log, WHEEL_QUEUE, 4);
+    struct planner planners[num_agents];
+    struct event_listener listeners[num_agents*SENSORY_EVENT_COUNT];
+
+    simulation_set_workers(sim, thread_count);
+    srand(FIXED_SEED);
+    for (int i = 0; i < num_agents; i++) {
+        struct agent a;
+        planners[i].id = i;
+        planners[i].seed = i;
+        a.state = &planners[i];
+        a.next_firing = turn_next_firing;
+        a.kind = i % 3;
+        a.fire = NULL;
+        a.plan = busy_plan;
+        a.apply = log_apply;
+        a.listeners = &listeners[i*SENSORY_EVENT_COUNT];
+        schedule_event(sim, simulation_push_agent(sim, &a), 0);
+    }
+
+    sync_simulation(sim, 200);
+
+    destroy_simulation(sim);
+}
+
+START_TEST(parallel_batches_are_deterministic) {
+    intent_vector serial, parallel;
+    intent_vector_init(&serial);
+    intent_vector_init(&parallel);
+    run_batches(&serial, 1);
+    run_batches(&parallel, 4);
+
+    ck_assert_int_eq(serial.length, parallel.length);
+    ck_assert(serial.length > 1000);
+    for (int i = 0; i < serial.length; i++) {
+        struct intent *a = intent_vector_at(&serial, i);
+        struct intent *b = intent_vector_at(&parallel, i);
+        ck_assert_int_eq(a->action, b->action);
+        ck_assert_int_eq(a->dx, b->dx);
+    }
 
+    intent_vector_free(&serial);
+    intent_vector_free(&parallel);
 } END_TEST
 
 Suite * make_simulation_suite(void)
@@ -63,6 +470,14 @@ Suite * make_simulation_suite(void)
 
     tcase_add_checked_fixture(tc_core, simulation_setup, simulation_teardown);
     tcase_add_test(tc_core, development_target);
+    tcase_add_test(tc_core, events_are_recycled);
+    tcase_add_test(tc_core, wheel_matches_heap);
+    tcase_add_test(tc_core, spawning_while_firing);
+    tcase_add_test(tc_core, cancellations_reschedule_in_place);
+    tcase_add_test(tc_core, parallel_batches_are_deterministic);
+    tcase_add_test(tc_core, retired_agents_stop_firing);
+    tcase_add_test(tc_core, lod_stretches_delays);
+    tcase_add_test(tc_core, stats_count_firings);
     suite_add_tcase(s, tc_core);
 
     return s;
@@ -0,0 +1,120 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../simulation/spatial_index.h"
+
+#define GRID 40
+
+void spatial_index_setup(void) {
+};
+
+void spatial_index_teardown(void) {
+};
+
+// Count the ids on the list that are at (x, y)
+static int found_at(struct spatial_index *index, int_vector *ids, int x, int y) {
+    int found = 0;
+    for (int i = 0; i < ids->length; i++) {
+        struct spatial_entry *e = spatial_index_get(index, ids->e[i]);
+        if (e->x == x && e->y == y) found++;
+    }
+    return found;
+}
+
+START_TEST(queries_find_what_is_inside) {
+    struct spatial_index *index = make_spatial_index(GRID, GRID, 8);
+    int things[GRID][GRID];
+    int_vector ids;
+    int_vector_init(&ids);
+
+    // One thing on every tile
+    for (int x = 0; x < GRID; x++) {
+        for (int y = 0; y < GRID; y++) {
+            spatial_index_insert(index, &things[x][y], x, y);
+        }
+    }
+
+    spatial_index_within(index, 10, 12, 5, &ids);
+    int expected = 0;
+    for (int x = 0; x < GRID; x++) {
+        for (int y = 0; y < GRID; y++) {
+            bool near = (x-10)*(x-10) + (y-12)*(y-12) <= 25;
+            ck_assert_int_eq(found_at(index, &ids, x, y), near ? 1 : 0);
+            if (near) expected++;
+        }
+    }
+    ck_assert_int_eq(ids.length, expected);
+
+    int_vector_clear(&ids);
+    spatial_index_rect(index, 5, 30, 17, 45, &ids);
+    ck_assert_int_eq(ids.length, 13 * 10);
+    for (int i = 0; i < ids.length; i++) {
+        struct spatial_entry *e = spatial_index_get(index, ids.e[i]);
+        ck_assert_ptr_eq(e->thing, &things[e->x][e->y]);
+        ck_assert(5 <= e->x && e->x <= 17 && 30 <= e->y);
+    }
+
+    // The edge of the map clips
+    int_vector_clear(&ids);
+    spatial_index_within(index, 0, 0, 1, &ids);
+    ck_assert_int_eq(ids.length, 3);
+
+    int_vector_free(&ids);
+    destroy_spatial_index(index);
+} END_TEST
+
+START_TEST(moves_and_removals_are_seen) {
+    struct spatial_index *index = make_spatial_index(GRID, GRID, 8);
+    int a, b, c;
+    int_vector ids;
+    int_vector_init(&ids);
+
+    int id_a = spatial_index_insert(index, &a, 1, 1);
+    int id_b = spatial_index_insert(index, &b, 2, 2);
+    int id_c = spatial_index_insert(index, &c, 3, 3);
+
+    // Across cells, and within one
+    spatial_index_move(index, id_a, 30, 30);
+    spatial_index_move(index, id_c, 4, 3);
+    spatial_index_remove(index, id_b);
+
+    spatial_index_rect(index, 0, 0, 7, 7, &ids);
+    ck_assert_int_eq(ids.length, 1);
+    ck_assert_int_eq(ids.e[0], id_c);
+    ck_assert_int_eq(found_at(index, &ids, 4, 3), 1);
+
+    int_vector_clear(&ids);
+    spatial_index_within(index, 30, 30, 0, &ids);
+    ck_assert_int_eq(ids.length, 1);
+    ck_assert_ptr_eq(spatial_index_get(index, ids.e[0])->thing, &a);
+
+    // Removed ids are handed out again
+    ck_assert_int_eq(spatial_index_insert(index, &b, 5, 5), id_b);
+    int_vector_clear(&ids);
+    spatial_index_rect(index, 0, 0, 7, 7, &ids);
+    ck_assert_int_eq(ids.length, 2);
+
+    int_vector_free(&ids);
+    destroy_spatial_index(index);
+} END_TEST
+
+Suite * make_spatial_index_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Spatial Index");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, spatial_index_setup, spatial_index_teardown);
+    tcase_add_test(tc_core, queries_find_what_is_inside);
+    tcase_add_test(tc_core, moves_and_removals_are_seen);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
@@ -0,0 +1,204 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <check.h>
+
+#include "../check_check.h"
+
+#include "../../simulation/timing_wheel.h"
+
+#define SLOT_WIDTH 1000
+
+void timing_wheel_setup(void) {
+};
+
+void timing_wheel_teardown(void) {
+};
+
+START_TEST(development_target) {
+    struct event a, b, c, d, e;
+    timing_wheel *w = make_timing_wheel(SLOT_WIDTH);
+    timing_wheel_push(w, &a, 1010);
+    timing_wheel_push(w, &b, 1009);
+    timing_wheel_push(w, &c, 8);
+    timing_wheel_push(w, &d, 20000000);
+    struct event *new_data;
+    sim_clock priority;
+
+    timing_wheel_peek(w, &new_data, &priority);
+    ck_assert(new_data == &c);
+    ck_assert(priority == 8);
+
+    timing_wheel_pop(w, &new_data, &priority);
+    ck_assert(new_data == &c);
+    ck_assert(priority == 8);
+    ck_assert_int_eq(c.queue_index, -1);
+
+    timing_wheel_pop(w, &new_data, &priority);
+    ck_assert(new_data == &b);
+    ck_assert(priority == 1009);
+
+    // Due before the slot being drained, so it comes out next
+    timing_wheel_push(w, &e, 0);
+    timing_wheel_pop(w, &new_data, &priority);
+    ck_assert(new_data == &e);
+    ck_assert(priority == 0);
+
+    timing_wheel_pop(w, &new_data, &priority);
+    ck_assert(new_data == &a);
+    ck_assert(priority == 1010);
+
+    timing_wheel_pop(w, &new_data, &priority);
+    ck_assert(new_data == &d);
+    ck_assert(priority == 20000000);
+
+    timing_wheel_peek(w, &new_data, &priority);
+    ck_assert(new_data == NULL);
+    ck_assert(priority == CLOCK_NEVER);
+    ck_assert_int_eq(w->length, 0);
+
+    destroy_timing_wheel(w);
+} END_TEST
+
+START_TEST(update_and_remove) {
+    const int len = 1000;
+    struct event events[len];
+    sim_clock clocks[len];
+    bool queued[len];
+    struct event *cur_d;
+    sim_clock cur_p, last_p;
+
+    srand(FIXED_SEED);
+    timing_wheel *w = make_timing_wheel(SLOT_WIDTH);
+    for (int i = 0; i < len; i++) {
+        clocks[i] = rand() % 100000;
+        queued[i] = true;
+        timing_wheel_push(w, &events[i], clocks[i]);
+    }
+
+    // Move every event somewhere else, either way, and drop a few
+    for (int i = 0; i < len; i++) {
+        if (i % 7 == 0) {
+            timing_wheel_remove(w, &events[i]);
+            ck_assert_int_eq(events[i].queue_index, -1);
+            queued[i] = false;
+        } else {
+            clocks[i] = (i % 3 == 0) ? CLOCK_NEVER : rand() % 100000;
+            timing_wheel_update(w, &events[i], clocks[i]);
+        }
+    }
+
+    last_p = 0;
+    while (w->length > 0) {
+        timing_wheel_pop(w, &cur_d, &cur_p);
+        int i = cur_d - events;
+        ck_assert(queued[i]);
+        ck_assert(cur_p == clocks[i]);
+        ck_assert(cur_p >= last_p);
+        queued[i] = false;
+        last_p = cur_p;
+    }
+    for (int i = 0; i < len; i++) {
+        ck_assert(!queued[i]);
+    }
+
+    destroy_timing_wheel(w);
+} END_TEST
+
+START_TEST(big_insert_with_interspersed_pops) {
+    const int len = 10000;
+    sim_clock last_p;
+    sim_clock cur_p;
+    struct event *cur_d;
+    int total_popped;
+    struct event *events = malloc(len * sizeof(struct event));
+
+    srand(FIXED_SEED);
+    timing_wheel *w = make_timing_wheel(SLOT_WIDTH);
+    for (int i = 0; i < len; i++) {
+        timing_wheel_push(w, &events[i], rand() % (SLOT_WIDTH * WHEEL_SLOTS * WHEEL_SLOTS * 4));
+    }
+
+    last_p = 0;
+    total_popped = 0;
+    while (w->length > 0) {
+        timing_wheel_pop(w, &cur_d, &cur_p);
+        ck_assert(cur_p >= last_p);
+        last_p = cur_p;
+        total_popped += 1;
+        if (total_popped <= len) {
+            // Mostly a turn or two ahead, occasionally far beyond the wheel
+            sim_clock delay = (rand() % 8 == 0) ? rand() : SLOT_WIDTH + rand() % (SLOT_WIDTH * 3);
+            timing_wheel_push(w, cur_d, cur_p + delay);
+        }
+    }
+    ck_assert_int_eq(total_popped, len*2);
+
+    free((void*)events);
+
+    destroy_timing_wheel(w);
+} END_TEST
+
+START_TEST(never_comes_last) {
+    timing_wheel *w = make_timing_wheel(SLOT_WIDTH);
+    struct event *e;
+    struct event never, late, later;
+    sim_clock clock;
+
+    timing_wheel_push(w, &never, CLOCK_NEVER);
+    timing_wheel_push(w, &later, (sim_clock)INT_MAX + 2000);
+    timing_wheel_push(w, &late, 5);
+
+    timing_wheel_pop(w, &e, &clock);
+    ck_assert(clock == 5);
+    timing_wheel_pop(w, &e, &clock);
+    ck_assert(clock == (sim_clock)INT_MAX + 2000);
+    timing_wheel_pop(w, &e, &clock);
+    ck_assert(clock == CLOCK_NEVER);
+    ck_assert_int_eq(w->length, 0);
+
+    destroy_timing_wheel(w);
+} END_TEST
+
+START_TEST(zero_slot_width_is_one_tick) {
+    timing_wheel *w = make_timing_wheel(0);
+    struct event *e;
+    struct event a, b, c;
+    sim_clock clock;
+    ck_assert(w->slot_width == 1);
+
+    timing_wheel_push(w, &a, 70);
+    timing_wheel_push(w, &b, 3);
+    timing_wheel_push(w, &c, 3000);
+
+    timing_wheel_pop(w, &e, &clock);
+    ck_assert(e == &b && clock == 3);
+    timing_wheel_pop(w, &e, &clock);
+    ck_assert(e == &a && clock == 70);
+    timing_wheel_pop(w, &e, &clock);
+    ck_assert(e == &c && clock == 3000);
+
+    destroy_timing_wheel(w);
+} END_TEST
+
+Suite * make_timing_wheel_suite(void)
+{
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Timing Wheel");
+
+    /* Core test case */
+    tc_core = tcase_create("Core");
+
+    tcase_add_checked_fixture(tc_core, timing_wheel_setup, timing_wheel_teardown);
+    tcase_add_test(tc_core, development_target);
+    tcase_add_test(tc_core, update_and_remove);
+    tcase_add_test(tc_core, big_insert_with_interspersed_pops);
+    tcase_add_test(tc_core, never_comes_last);
+    tcase_add_test(tc_core, zero_slot_width_is_one_tick);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
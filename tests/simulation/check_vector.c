@@ -5,7 +5,13 @@
 
 #include "../check_check.h"
 
-#include "../../simulation/vector.h"
+#include "../../simulation/containers.h"
+
+typedef struct {
+    int key;
+    int payload;
+} keyed;
+HEAP_DEFINE(keyed_heap, keyed, key)
 
 void vector_setup(void) {
 };
@@ -14,80 +20,112 @@ void vector_teardown(void) {
 };
 
 START_TEST(development_target) {
-    vector *v = make_vector(sizeof(int));
-    int data = 0;
-
-    vector_push(v, &data);
-    data = 1;
-    vector_push(v, &data);
-    data = -1;
-    vector_push(v, &data);
-
-    ck_assert(*(int*)vector_peek(v) == -1);
-
-    ck_assert(*(int*)vector_get(v, 0) == 0);
-    ck_assert(*(int*)vector_get(v, 1) == 1);
-    ck_assert(*(int*)vector_get(v, 2) == -1);
-
-    data = 3;
-    vector_set(v, 1, (void*)&data);
-    ck_assert(*(int*)vector_get(v, 1) == 3);
-
-    vector_swap(v, 1, 2);
-
-    int *r;
-    vector_pop(v, (void**)&r);
-    ck_assert(*r == 3);
-    vector_pop(v, (void**)&r);
-    ck_assert(*r == -1);
-    vector_pop(v, (void**)&r);
-    ck_assert(*r == 0);
+    int_vector v;
+    int_vector_init(&v);
+
+    int_vector_push(&v, 0);
+    int_vector_push(&v, 1);
+    int_vector_push(&v, -1);
+
+    ck_assert(*int_vector_peek(&v) == -1);
+
+    ck_assert(*int_vector_at(&v, 0) == 0);
+    ck_assert(*int_vector_at(&v, 1) == 1);
+    ck_assert(*int_vector_at(&v, 2) == -1);
+
+    *int_vector_at(&v, 1) = 3;
+    ck_assert(*int_vector_at(&v, 1) == 3);
+
+    int_vector_swap(&v, 1, 2);
+
+    ck_assert(int_vector_pop(&v) == 3);
+    ck_assert(int_vector_pop(&v) == -1);
+    ck_assert(int_vector_pop(&v) == 0);
+    ck_assert_int_eq(v.length, 0);
+
+    int_vector_free(&v);
 } END_TEST
 
 START_TEST(get_and_set) {
     int len = 1000;
     int data[len];
     int i, j;
-    vector *v = make_vector(sizeof(int));
+    int_vector v;
+    int_vector_init(&v);
 
     srand(FIXED_SEED);
     for (int i = 0; i < len; i++) {
         data[i] = rand();
-        vector_push(v, &data[i]);
+        int_vector_push(&v, data[i]);
     }
 
     for (i = 0; i < len; i++) {
-        ck_assert(data[i] == *(int*)vector_get(v, i));
+        ck_assert(data[i] == v.e[i]);
     }
 
     for (i = 0, j = len-1; i < len; i++, j--) {
-        vector_set(v, i, (void*)&data[j]);
+        v.e[i] = data[j];
     }
 
     for (i = 0, j = len-1; i < len; i++, j--) {
-        ck_assert(data[i] == *(int*)vector_get(v, j));
+        ck_assert(data[i] == v.e[j]);
     }
+
+    // Popping everything and pushing again reuses the storage
+    int capacity = v.capacity;
+    while (v.length > 0) int_vector_pop(&v);
+    for (i = 0; i < len; i++) int_vector_push(&v, data[i]);
+    ck_assert_int_eq(v.capacity, capacity);
+    ck_assert(data[len-1] == *int_vector_peek(&v));
+
+    int_vector_free(&v);
 } END_TEST
 
 START_TEST(swapping) {
     int len = 3;
     int data[len];
     int i, j;
-    vector *v = make_vector(sizeof(int));
+    int_vector v;
+    int_vector_init(&v);
 
     srand(FIXED_SEED);
     for (int i = 0; i < len; i++) {
         data[i] = rand();
-        vector_push(v, &data[i]);
+        int_vector_push(&v, data[i]);
     }
 
     for (i = 0, j = len-1; i < len-1; i++, j--) {
-        vector_swap(v, i, j);
+        int_vector_swap(&v, i, j);
     }
 
     for (i = 0, j = len-1; i < len; i++, j--) {
-        ck_assert(data[i] == *(int*)vector_get(v, j));
+        ck_assert(data[i] == v.e[j]);
+    }
+
+    int_vector_free(&v);
+} END_TEST
+
+START_TEST(heap_order) {
+    int len = 1000;
+    keyed_heap h;
+    keyed_heap_init(&h);
+
+    srand(FIXED_SEED);
+    for (int i = 0; i < len; i++) {
+        keyed k = {rand() % 100, i};
+        keyed_heap_push(&h, k);
     }
+
+    int last = -1;
+    for (int i = 0; i < len; i++) {
+        ck_assert(keyed_heap_peek(&h)->key >= last);
+        keyed k = keyed_heap_pop(&h);
+        ck_assert(k.key >= last);
+        last = k.key;
+    }
+    ck_assert_int_eq(h.length, 0);
+
+    keyed_heap_free(&h);
 } END_TEST
 
 Suite * make_vector_suite(void)
@@ -104,6 +142,7 @@ Suite * make_vector_suite(void)
     tcase_add_test(tc_core, development_target);
     tcase_add_test(tc_core, get_and_set);
     tcase_add_test(tc_core, swapping);
+    tcase_add_test(tc_core, heap_order);
     suite_add_tcase(s, tc_core);
 
     return s;